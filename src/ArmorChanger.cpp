@@ -1,8 +1,13 @@
 #include "ArmorChanger.h"
 
+#include "Cache.h"
+#include "ChangeFields.h"
 #include "Config.h"
 #include "Data.h"
+#include "JsonArena.h"
 #include "LootLists.h"
+#include "StatMath.h"
+#include "Tasks.h"
 #include "rapidjson/document.h"
 #include "rapidjson/error/en.h"
 #include "rapidjson/error/error.h"
@@ -11,6 +16,8 @@
 #include "rapidjson/prettywriter.h"
 #include "rapidjson/stringbuffer.h"
 
+#include <future>
+
 using namespace rapidjson;
 
 namespace {
@@ -61,6 +68,7 @@ namespace {
 
     void ClearRecipe(RE::BGSConstructibleObject* tar);
     void ReplaceRecipe(RE::BGSConstructibleObject* tar, const RE::BGSConstructibleObject* src, float w);
+    void ReplaceRecipes(const RecipeIndex::RecipeList& tar, const RecipeIndex::RecipeList* src, float w);
 
     ArmorSlots RemapSlots(ArmorSlots slots, const ArmorChangeParams& params) {
         ArmorSlots slotsRemapped = slots;
@@ -84,18 +92,9 @@ namespace {
         return slots;
     }
 
-    std::pair<ArmorSlots, ArmorSlots> CalcCoveredSlots(const auto& items, const ArmorChangeParams& params,
+    // Build list of slots that will be used for scaling
+    std::pair<ArmorSlots, ArmorSlots> CalcCoveredSlots(ArmorSlots coveredSlots, const ArmorChangeParams& params,
                                                        bool remap = false) {
-        ArmorSlots coveredSlots = 0;
-        // Build list of slots that will be used for scaling
-        for (auto i : items) {
-            if (auto armor = i->As<RE::TESObjectARMO>()) {
-                auto slots = (ArmorSlots)armor->GetSlotMask();
-                if (remap) slots = MapFindOr(g_Data.modifiedArmorSlots, armor, slots);
-                coveredSlots |= slots;
-            }
-        }
-
         if (remap) coveredSlots = RemapSlots(coveredSlots, params);
 
         // Head slot is weird and needs special handling
@@ -111,6 +110,12 @@ namespace {
         return {PromoteHeadSlots(coveredSlots, coveredHeadSlots), coveredHeadSlots};
     }
 
+    ArmorSlots GetSetSlots(const ArmorChangeParams& params) {
+        ArmorSlots slots = 0;
+        for (auto i : params.armorSet->items) slots |= (ArmorSlots)i->GetSlotMask();
+        return slots;
+    }
+
     void ProcessBaseArmorSet(const ArmorChangeParams& params, ArmorSlots coveredHeadSlots, const auto& fn) {
         for (auto i : params.armorSet->items) {
             auto slots = PromoteHeadSlots((ArmorSlots)i->GetSlotMask(), coveredHeadSlots);
@@ -147,200 +152,195 @@ namespace {
                          MemoryPoolAllocator<>& al) {
         if (pair.bModify) changes.AddMember(StringRef(field), Value(0.01f * pair.fScale), al);
     }
-}
 
-ArmorSlots QuickArmorRebalance::GetConvertableArmorSlots(const ArmorChangeParams& params) {
-    params.remapMask = 0;
-    for (auto i : params.mapArmorSlots) params.remapMask |= (1 << i.first);
-
-    auto [coveredSlots, coveredHeadSlots] = CalcCoveredSlots(params.armorSet->items, params);
-
-    coveredSlots = 0;  // weird case where an item's in the armor set but not in the curve tree
-
-    ProcessBaseArmorSet(params, coveredHeadSlots, [&](ArmorSlot slot, RE::TESObjectARMO*) {
-        coveredSlots |= GetAllCoveredSlots(*params.curve, slot);
-    });
+    using FileChanges = std::map<RE::TESFile*, Value>;
 
-    return coveredSlots;
-}
+    // Works out the change json for every item without modifying any forms, so it can run off the render thread. With
+    // only set, just that item's change is built, though the slots covered are still worked out from every item
+    void BuildArmorChanges(const ArmorChangeParams& params, FileChanges& mapFileChanges, MemoryPoolAllocator<>& al,
+                           const std::atomic<bool>& cancel, std::atomic<std::size_t>& built,
+                           const RE::TESBoundObject* only = nullptr) {
+        params.bMixedSetDone = false;
 
-void QuickArmorRebalance::MakeArmorChanges(const ArmorChangeParams& params) {
-    if (params.items.empty()) return;
-    params.bMixedSetDone = false;
+        params.remapMask = 0;
+        for (auto i : params.mapArmorSlots) params.remapMask |= (1 << i.first);
 
-    params.remapMask = 0;
-    for (auto i : params.mapArmorSlots) params.remapMask |= (1 << i.first);
+        // Need to use the original slots, or double-applying will loose data
+        ArmorSlots itemSlots = 0;
+        for (auto slots : params.itemSlots) itemSlots |= slots;
 
-    // Build list of base items per slot
-    auto [_discard, coveredHeadSlots] = CalcCoveredSlots(params.armorSet->items, params);
-    auto [coveredSlots, coveredHeadSlotsChanges] = CalcCoveredSlots(params.items, params, true);
+        // Build list of base items per slot
+        auto [_discard, coveredHeadSlots] = CalcCoveredSlots(GetSetSlots(params), params);
+        auto [coveredSlots, coveredHeadSlotsChanges] = CalcCoveredSlots(itemSlots, params, true);
 
-    SlotRelativeWeight slotValues[32];
+        SlotRelativeWeight slotValues[32];
 
-    ProcessBaseArmorSet(params, coveredHeadSlots,
-                        [&](ArmorSlot slot, RE::TESObjectARMO* i) { slotValues[slot].item = i; });
+        ProcessBaseArmorSet(params, coveredHeadSlots,
+                            [&](ArmorSlot slot, RE::TESObjectARMO* i) { slotValues[slot].item = i; });
 
-    int totalWeight = 0;
-    for (const auto& i : *params.curve) totalWeight += GetTotalWeight(&i);
-    for (const auto& i : *params.curve) PropogateBaseValues(slotValues, nullptr, &i);
-    for (const auto& i : *params.curve) CalcCoveredValues(slotValues, coveredSlots, &i);
+        int totalWeight = 0;
+        for (const auto& i : *params.curve) totalWeight += GetTotalWeight(&i);
+        for (const auto& i : *params.curve) PropogateBaseValues(slotValues, nullptr, &i);
+        for (const auto& i : *params.curve) CalcCoveredValues(slotValues, coveredSlots, &i);
 
-    Document doc;
-    auto& al = doc.GetAllocator();
+        for (std::size_t n = 0; n < params.items.size(); n++) {
+            if (cancel) return;
 
-    std::map<RE::TESFile*, Value> mapFileChanges;
+            auto i = params.items[n];
+            if (only && i != only) continue;
+            built++;
 
-    for (auto i : params.items) {
-        if (auto armor = i->As<RE::TESObjectARMO>()) {
-            SlotRelativeWeight* itemBase = nullptr;
-            int weight = 0;
+            if (auto armor = i->As<RE::TESObjectARMO>()) {
+                SlotRelativeWeight* itemBase = nullptr;
+                int weight = 0;
 
-            // Need to retrieve the original slots, or double-applying will loose data
-            ArmorSlots slotsOrig = MapFindOr(g_Data.modifiedArmorSlots, armor, (ArmorSlots)armor->GetSlotMask());
-            ArmorSlots slotsRemapped = RemapSlots(slotsOrig, params);
-            ArmorSlots slots = slotsRemapped;
+                ArmorSlots slotsOrig = params.itemSlots[n];
+                ArmorSlots slotsRemapped = RemapSlots(slotsOrig, params);
+                ArmorSlots slots = slotsRemapped;
 
-            slots = PromoteHeadSlots(slots, coveredHeadSlotsChanges);
+                slots = PromoteHeadSlots(slots, coveredHeadSlotsChanges);
 
-            while (slots) {
-                unsigned long slot;
-                _BitScanForward(&slot, slots);
-                slots &= slots - 1;
+                while (slots) {
+                    unsigned long slot;
+                    _BitScanForward(&slot, slots);
+                    slots &= slots - 1;
 
-                auto& v = slotValues[slot];
-                if (v.base && v.base->weightBase) {
-                    if (!itemBase) itemBase = v.base;
-                    weight += v.weightUsed;
+                    auto& v = slotValues[slot];
+                    if (v.base && v.base->weightBase) {
+                        if (!itemBase) itemBase = v.base;
+                        weight += v.weightUsed;
+                    }
                 }
-            }
 
-            if (itemBase) {
-                float rel = itemBase->weightBase > 0 ? (float)weight / itemBase->weightBase : 0.0f;
-                Value changes(kObjectType);
-                changes.AddMember("name", Value(i->GetName(), al), al);
-                changes.AddMember("srcname", Value(itemBase->item->GetFullName(), al), al);
-                changes.AddMember("srcfile", Value(itemBase->item->GetFile(0)->fileName, al), al);
-                changes.AddMember("srcid", Value(GetFileId(itemBase->item)), al);
-                changes.AddMember("w", Value(rel), al);
-                if (params.bModifyKeywords) changes.AddMember("keywords", Value(true), al);
-
-                AddModification("armor", params.armor.rating, changes, al);
-                AddModification("weight", params.armor.weight, changes, al);
-                AddModification("value", params.value, changes, al);
-                if (slotsRemapped != slotsOrig) changes.AddMember("slots", slotsRemapped, al);
-
-                if (params.temper.bModify) {
-                    Value recipe(kObjectType);
-                    if (params.temper.bNew) recipe.AddMember("new", Value(true), al);
-                    if (params.temper.bFree) recipe.AddMember("free", Value(true), al);
-                    changes.AddMember("temper", recipe, al);
-                }
-                if (params.craft.bModify) {
-                    Value recipe(kObjectType);
-                    if (params.craft.bNew) recipe.AddMember("new", Value(true), al);
-                    if (params.craft.bFree) recipe.AddMember("free", Value(true), al);
-                    changes.AddMember("craft", recipe, al);
-                }
+                if (itemBase) {
+                    float rel = itemBase->weightBase > 0 ? (float)weight / itemBase->weightBase : 0.0f;
+                    Value changes(kObjectType);
+                    changes.AddMember("name", Value(i->GetName(), al), al);
+                    changes.AddMember("srcname", Value(itemBase->item->GetFullName(), al), al);
+                    changes.AddMember("srcfile", Value(itemBase->item->GetFile(0)->fileName, al), al);
+                    changes.AddMember("srcid", Value(GetFileId(itemBase->item)), al);
+                    changes.AddMember("w", Value(rel), al);
+                    if (params.bModifyKeywords) changes.AddMember("keywords", Value(true), al);
+
+                    AddModification("armor", params.armor.rating, changes, al);
+                    AddModification("weight", params.armor.weight, changes, al);
+                    AddModification("value", params.value, changes, al);
+                    if (slotsRemapped != slotsOrig) changes.AddMember("slots", slotsRemapped, al);
+
+                    if (params.temper.bModify) {
+                        Value recipe(kObjectType);
+                        if (params.temper.bNew) recipe.AddMember("new", Value(true), al);
+                        if (params.temper.bFree) recipe.AddMember("free", Value(true), al);
+                        changes.AddMember("temper", recipe, al);
+                    }
+                    if (params.craft.bModify) {
+                        Value recipe(kObjectType);
+                        if (params.craft.bNew) recipe.AddMember("new", Value(true), al);
+                        if (params.craft.bFree) recipe.AddMember("free", Value(true), al);
+                        changes.AddMember("craft", recipe, al);
+                    }
 
-                auto loot = MakeLootChanges(params, armor, al);
-                if (!loot.IsNull()) changes.AddMember("loot", loot, al);
+                    auto loot = MakeLootChanges(params, armor, al);
+                    if (!loot.IsNull()) changes.AddMember("loot", loot, al);
 
-                /*
-                if (!ApplyChanges(i->GetFile(0), GetFileId(i), changes, g_Config.permLocal)) {
-                    logger::error("Failed to apply changes");
-                }
-                */
+                    /*
+                    if (!ApplyChanges(i->GetFile(0), GetFileId(i), changes, g_Config.permLocal)) {
+                        logger::error("Failed to apply changes");
+                    }
+                    */
 
-                Value* ls = &mapFileChanges[i->GetFile(0)];
-                if (!ls->IsObject()) ls->SetObject();
+                    Value* ls = &mapFileChanges[i->GetFile(0)];
+                    if (!ls->IsObject()) ls->SetObject();
 
-                ls->AddMember(Value(std::to_string(GetFileId(i)).c_str(), al), changes, al);
-            } else
-                logger::debug("No item base, skipping changes to {}", i->GetName());
-        } else if (auto weap = i->As<RE::TESObjectWEAP>()) {
-            if (auto itemBase = params.armorSet->FindMatching(weap)) {
-                Value changes(kObjectType);
-                changes.AddMember("name", Value(i->GetName(), al), al);
-                changes.AddMember("srcname", Value(itemBase->GetFullName(), al), al);
-                changes.AddMember("srcfile", Value(itemBase->GetFile(0)->fileName, al), al);
-                changes.AddMember("srcid", Value(GetFileId(itemBase)), al);
-
-                if (params.bModifyKeywords) changes.AddMember("keywords", Value(true), al);
-
-                AddModification("damage", params.weapon.damage, changes, al);
-                AddModification("weight", params.weapon.weight, changes, al);
-                AddModification("speed", params.weapon.speed, changes, al);
-                AddModification("stagger", params.weapon.stagger, changes, al);
-                AddModification("value", params.value, changes, al);
-
-                if (params.temper.bModify) {
-                    Value recipe(kObjectType);
-                    if (params.temper.bNew) recipe.AddMember("new", Value(true), al);
-                    if (params.temper.bFree) recipe.AddMember("free", Value(true), al);
-                    changes.AddMember("temper", recipe, al);
-                }
-                if (params.craft.bModify) {
-                    Value recipe(kObjectType);
-                    if (params.craft.bNew) recipe.AddMember("new", Value(true), al);
-                    if (params.craft.bFree) recipe.AddMember("free", Value(true), al);
-                    changes.AddMember("craft", recipe, al);
-                }
+                    ls->AddMember(Value(std::to_string(GetFileId(i)).c_str(), al), changes, al);
+                } else
+                    logger::debug("No item base, skipping changes to {}", i->GetName());
+            } else if (auto weap = i->As<RE::TESObjectWEAP>()) {
+                if (auto itemBase = params.armorSet->FindMatching(weap)) {
+                    Value changes(kObjectType);
+                    changes.AddMember("name", Value(i->GetName(), al), al);
+                    changes.AddMember("srcname", Value(itemBase->GetFullName(), al), al);
+                    changes.AddMember("srcfile", Value(itemBase->GetFile(0)->fileName, al), al);
+                    changes.AddMember("srcid", Value(GetFileId(itemBase)), al);
+
+                    if (params.bModifyKeywords) changes.AddMember("keywords", Value(true), al);
+
+                    AddModification("damage", params.weapon.damage, changes, al);
+                    AddModification("weight", params.weapon.weight, changes, al);
+                    AddModification("speed", params.weapon.speed, changes, al);
+                    AddModification("stagger", params.weapon.stagger, changes, al);
+                    AddModification("value", params.value, changes, al);
+
+                    if (params.temper.bModify) {
+                        Value recipe(kObjectType);
+                        if (params.temper.bNew) recipe.AddMember("new", Value(true), al);
+                        if (params.temper.bFree) recipe.AddMember("free", Value(true), al);
+                        changes.AddMember("temper", recipe, al);
+                    }
+                    if (params.craft.bModify) {
+                        Value recipe(kObjectType);
+                        if (params.craft.bNew) recipe.AddMember("new", Value(true), al);
+                        if (params.craft.bFree) recipe.AddMember("free", Value(true), al);
+                        changes.AddMember("craft", recipe, al);
+                    }
 
-                auto loot = MakeLootChanges(params, weap, al);
-                if (!loot.IsNull()) changes.AddMember("loot", loot, al);
+                    auto loot = MakeLootChanges(params, weap, al);
+                    if (!loot.IsNull()) changes.AddMember("loot", loot, al);
 
-                Value* ls = &mapFileChanges[i->GetFile(0)];
-                if (!ls->IsObject()) ls->SetObject();
+                    Value* ls = &mapFileChanges[i->GetFile(0)];
+                    if (!ls->IsObject()) ls->SetObject();
 
-                ls->AddMember(Value(std::to_string(GetFileId(i)).c_str(), al), changes, al);
-            } else
-                logger::debug("No item base, skipping changes to {}", i->GetName());
-        } else if (auto ammo = i->As<RE::TESAmmo>()) {
-            if (auto itemBase = params.armorSet->FindMatching(ammo)) {
-                Value changes(kObjectType);
-                changes.AddMember("name", Value(i->GetName(), al), al);
-                changes.AddMember("srcname", Value(itemBase->GetFullName(), al), al);
-                changes.AddMember("srcfile", Value(itemBase->GetFile(0)->fileName, al), al);
-                changes.AddMember("srcid", Value(GetFileId(itemBase)), al);
-
-                if (params.bModifyKeywords) changes.AddMember("keywords", Value(true), al);
-
-                AddModification("damage", params.weapon.damage, changes, al);
-                AddModification("weight", params.weapon.weight, changes, al);
-                AddModification("value", params.value, changes, al);
-
-                if (params.temper.bModify) {
-                    Value recipe(kObjectType);
-                    if (params.temper.bNew) recipe.AddMember("new", Value(true), al);
-                    if (params.temper.bFree) recipe.AddMember("free", Value(true), al);
-                    changes.AddMember("temper", recipe, al);
-                }
-                if (params.craft.bModify) {
-                    Value recipe(kObjectType);
-                    if (params.craft.bNew) recipe.AddMember("new", Value(true), al);
-                    if (params.craft.bFree) recipe.AddMember("free", Value(true), al);
-                    changes.AddMember("craft", recipe, al);
-                }
+                    ls->AddMember(Value(std::to_string(GetFileId(i)).c_str(), al), changes, al);
+                } else
+                    logger::debug("No item base, skipping changes to {}", i->GetName());
+            } else if (auto ammo = i->As<RE::TESAmmo>()) {
+                if (auto itemBase = params.armorSet->FindMatching(ammo)) {
+                    Value changes(kObjectType);
+                    changes.AddMember("name", Value(i->GetName(), al), al);
+                    changes.AddMember("srcname", Value(itemBase->GetFullName(), al), al);
+                    changes.AddMember("srcfile", Value(itemBase->GetFile(0)->fileName, al), al);
+                    changes.AddMember("srcid", Value(GetFileId(itemBase)), al);
+
+                    if (params.bModifyKeywords) changes.AddMember("keywords", Value(true), al);
+
+                    AddModification("damage", params.weapon.damage, changes, al);
+                    AddModification("weight", params.weapon.weight, changes, al);
+                    AddModification("value", params.value, changes, al);
+
+                    if (params.temper.bModify) {
+                        Value recipe(kObjectType);
+                        if (params.temper.bNew) recipe.AddMember("new", Value(true), al);
+                        if (params.temper.bFree) recipe.AddMember("free", Value(true), al);
+                        changes.AddMember("temper", recipe, al);
+                    }
+                    if (params.craft.bModify) {
+                        Value recipe(kObjectType);
+                        if (params.craft.bNew) recipe.AddMember("new", Value(true), al);
+                        if (params.craft.bFree) recipe.AddMember("free", Value(true), al);
+                        changes.AddMember("craft", recipe, al);
+                    }
 
-                auto loot = MakeLootChanges(params, ammo, al);
-                if (!loot.IsNull()) changes.AddMember("loot", loot, al);
+                    auto loot = MakeLootChanges(params, ammo, al);
+                    if (!loot.IsNull()) changes.AddMember("loot", loot, al);
 
-                Value* ls = &mapFileChanges[i->GetFile(0)];
-                if (!ls->IsObject()) ls->SetObject();
+                    Value* ls = &mapFileChanges[i->GetFile(0)];
+                    if (!ls->IsObject()) ls->SetObject();
 
-                ls->AddMember(Value(std::to_string(GetFileId(i)).c_str(), al), changes, al);
-            } else
-                logger::debug("No item base, skipping changes to {}", i->GetName());
+                    ls->AddMember(Value(std::to_string(GetFileId(i)).c_str(), al), changes, al);
+                } else
+                    logger::debug("No item base, skipping changes to {}", i->GetName());
+            }
+        }
         }
-    }
 
-    for (auto& i : mapFileChanges) {
-        ApplyChanges(i.first, i.second, g_Config.permLocal);
+    // Merges the changes into the local change file for the mod and writes it out
+    void SaveFileChanges(const ArmorChangeParams& params, RE::TESFile* file, Value& changes, Document& doc) {
+        auto& al = doc.GetAllocator();
 
         std::filesystem::path path(std::filesystem::current_path() / PATH_ROOT PATH_CHANGES "local/");
         std::filesystem::create_directories(path);
 
-        path /= i.first->fileName;
+        path /= file->fileName;
         path += ".json";
 
         if (std::filesystem::exists(path.generic_string().c_str())) {
@@ -364,15 +364,15 @@ void QuickArmorRebalance::MakeArmorChanges(const ArmorChangeParams& params) {
 
             } else {
                 logger::warn("Could not open file {}", path.filename().generic_string());
-                continue;
+                return;
             }
         } else {
             doc.SetObject();
         }
 
-        if (!i.second.IsObject()) continue;
+        if (!changes.IsObject()) return;
 
-        for (auto& j : i.second.GetObj()) {
+        for (auto& j : changes.GetObj()) {
             if (!params.bMerge) {
                 doc.RemoveMember(j.name);  // it doesn't automaticaly remove duplicates
                 doc.AddMember(j.name, j.value, al);
@@ -412,53 +412,132 @@ void QuickArmorRebalance::MakeArmorChanges(const ArmorChangeParams& params) {
                 path.filename().generic_string(), path.generic_string(), std::strerror(errno));
         }
     }
-}
 
-void QuickArmorRebalance::ApplyChanges(const RE::TESFile* file, const rapidjson::Value& ls, const Permissions& perm) {
-    if (!ls.IsObject()) return;
+    void FinishFileChanges(const RE::TESFile* file, int nChanges, const Permissions& perm) {
+        logger::info("{}: {} changes made", file->fileName, nChanges);
+
+        if (nChanges > 0) {
+            if (&perm == &g_Config.permShared) {
+                g_Data.modifiedFilesShared.insert(file);
+            } else {
+                g_Data.modifiedFiles.insert(file);
+            }
+        }
+    }
+
+    // The change json is built on a worker thread from a copy of the parameters, then applied to the forms a few
+    // items per step and written out one file per step
+    class ArmorChangesTask : public Task {
+    public:
+        ArmorChangesTask(const ArmorChangeParams& p) : params(p) {
+            params.filteredItems.clear();
+            params.filteredOrdinals.clear();
+            build = std::async(std::launch::async, [this]() {
+                BuildArmorChanges(params, mapFileChanges, doc.GetAllocator(), bCancel, nBuilt);
+            });
+        }
+
+        ~ArmorChangesTask() {
+            bCancel = true;
+            if (build.valid()) build.wait();
+        }
+
+        const char* GetName() const override { return "Applying changes"; }
+
+        StepResult Step() override {
+            if (build.valid()) {
+                if (build.wait_for(0s) != std::future_status::ready) return StepResult::kYield;
+                build.get();
+
+                for (auto& i : mapFileChanges) nTotal += i.second.MemberCount();
+                itFile = mapFileChanges.begin();
+                return StepResult::kContinue;
+            }
 
-    int nChanges = 0;
+            if (itFile == mapFileChanges.end()) return StepResult::kDone;
 
-    for (auto& i : ls.GetObj()) {
-        if (!i.name.IsString()) {
-            logger::error("Invalid item id in {}", file->fileName);
-            continue;
+            auto& changes = itFile->second;
+            if (nFileApplied < changes.MemberCount()) {
+                auto& i = changes.MemberBegin()[nFileApplied++];
+                nApplied++;
+
+                RE::FormID id = atoi(i.name.GetString());
+                if (ApplyChanges(itFile->first, id, i.value, g_Config.permLocal))
+                    nFileChanges++;
+                else
+                    logger::error("Failed to apply changes to {}:{:#08x}", itFile->first->fileName, id);
+                return StepResult::kContinue;
+            }
+
+            FinishFile();
+            ++itFile;
+            return StepResult::kContinue;
         }
 
-        RE::FormID id = atoi(i.name.GetString());
-        if (ApplyChanges(file, id, i.value, perm))
-            nChanges++;
-        else
-            logger::error("Failed to apply changes to {}:{:#08x}", file->fileName, id);
-    }
+        float GetProgress() const override {
+            if (build.valid()) return params.items.empty() ? 0.0f : 0.5f * nBuilt / params.items.size();
+            return nTotal ? 0.5f + 0.5f * nApplied / nTotal : 1.0f;
+        }
 
-    logger::info("{}: {} changes made", file->fileName, nChanges);
+        void Cancel() override {
+            if (build.valid()) return;  // Nothing has been applied yet, the destructor stops the build
 
-    if (nChanges > 0) {
-        if (&perm == &g_Config.permShared) {
-            g_Data.modifiedFilesShared.insert(file);
-        } else {
-            g_Data.modifiedFiles.insert(file);
-            g_Data.modifiedFilesDeleted.erase(file);
+            // Keep the change file in step with what has already been applied to the forms
+            if (itFile != mapFileChanges.end() && nFileApplied > 0) {
+                auto& changes = itFile->second;
+                changes.EraseMember(changes.MemberBegin() + nFileApplied, changes.MemberEnd());
+                FinishFile();
+            }
+            logger::info("Changes cancelled after {} of {} items", nApplied, nTotal);
         }
-    }
+
+    private:
+        void FinishFile() {
+            FinishFileChanges(itFile->first, nFileChanges, g_Config.permLocal);
+            SaveFileChanges(params, itFile->first, itFile->second, doc);
+            nFileApplied = 0;
+            nFileChanges = 0;
+        }
+
+        ArmorChangeParams params;
+
+        ArenaDocument doc;
+        FileChanges mapFileChanges;
+        std::future<void> build;
+        std::atomic<bool> bCancel = false;
+        std::atomic<std::size_t> nBuilt = 0;
+
+        FileChanges::iterator itFile;
+        SizeType nFileApplied = 0;
+        int nFileChanges = 0;
+        std::size_t nApplied = 0;
+        std::size_t nTotal = 0;
+    };
 }
 
-template <class T, typename V>
-bool ChangeField(bool bAllowed, const char* field, const rapidjson::Value& changes, T* src, T* item, V T::*member,
-                 const auto& fn) {
-    if (bAllowed && changes.HasMember(field)) {
-        auto& jsonScale = changes[field];
-        if (!jsonScale.IsFloat()) return false;
+ArmorSlots QuickArmorRebalance::GetConvertableArmorSlots(const ArmorChangeParams& params) {
+    params.remapMask = 0;
+    for (auto i : params.mapArmorSlots) params.remapMask |= (1 << i.first);
 
-        auto scale = jsonScale.GetFloat();
-        if (src->*member && scale > 0.0f)
-            item->*member = fn(scale * src->*member);
-        else
-            item->*member = 0;
-    }
+    auto [coveredSlots, coveredHeadSlots] = CalcCoveredSlots(GetSetSlots(params), params);
 
-    return true;
+    coveredSlots = 0;  // weird case where an item's in the armor set but not in the curve tree
+
+    ProcessBaseArmorSet(params, coveredHeadSlots, [&](ArmorSlot slot, RE::TESObjectARMO*) {
+        coveredSlots |= GetAllCoveredSlots(*params.curve, slot);
+    });
+
+    return coveredSlots;
+}
+
+std::unique_ptr<QuickArmorRebalance::Task> QuickArmorRebalance::MakeArmorChangesTask(
+    const ArmorChangeParams& params) {
+    if (params.items.empty()) return nullptr;
+    return std::make_unique<ArmorChangesTask>(params);
+}
+
+void QuickArmorRebalance::MakeArmorChanges(const ArmorChangeParams& params) {
+    if (auto task = MakeArmorChangesTask(params)) RunTaskNow(*task);
 }
 
 void GetMatchingKeywords(const std::set<RE::BGSKeyword*>& set, std::vector<RE::BGSKeyword*>& addKwds,
@@ -495,292 +574,856 @@ void MatchKeywords(RE::BGSKeywordForm* item, std::vector<RE::BGSKeyword*>& addKw
     }
 }
 
-bool QuickArmorRebalance::ApplyChanges(const RE::TESFile* file, RE::FormID id, const rapidjson::Value& changes,
-                                       const Permissions& perm) {
-    if (!changes.IsObject()) return false;
+namespace {
+    using Arena = OriginalsArena;
+
+    Arena::Span CaptureRecipes(Arena& a, const RecipeIndex& index, RE::TESBoundObject* item) {
+        Arena::Span span{(std::uint32_t)a.recipeBuffer.size(), 0};
 
-    auto dataHandler = RE::TESDataHandler::GetSingleton();
+        auto recipes = index.Find(item);
+        if (!recipes) return span;
 
-    if (!changes.HasMember("srcfile") || !changes.HasMember("srcid")) return false;
+        for (auto recipe : *recipes) {
+            Arena::Recipe r{recipe, recipe->benchKeyword, recipe->data.numConstructed};
 
-    auto& jsonSrcFile = changes["srcfile"];
-    auto& jsonSrcId = changes["srcid"];
+            const auto& mats = recipe->requiredItems;
+            r.mats.start = (std::uint32_t)a.matBuffer.size();
+            for (unsigned int i = 0; i < mats.numContainerObjects; i++)
+                a.matBuffer.push_back({mats.containerObjects[i]->obj, mats.containerObjects[i]->count});
+            r.mats.count = (std::uint32_t)a.matBuffer.size() - r.mats.start;
 
-    if (!jsonSrcFile.IsString() || !jsonSrcId.IsUint()) return false;
+            r.conditions.start = (std::uint32_t)a.conditionBuffer.size();
+            for (auto cond = recipe->conditions.head; cond; cond = cond->next) a.conditionBuffer.push_back(cond->data);
+            r.conditions.count = (std::uint32_t)a.conditionBuffer.size() - r.conditions.start;
 
-    auto item = RE::TESForm::LookupByID(GetFullId(file, id));
-    if (!item) {
-        logger::info("Item not found {}:{:#08x}", file->fileName, id);
-        return false;
+            a.recipeBuffer.push_back(r);
+            span.count++;
+        }
+        return span;
     }
 
-    auto bo = item->As<RE::TESBoundObject>();
-    if (!bo) {
-        logger::info("Item wrong type {}:{:#08x}", file->fileName, id);
-        return false;
+    Arena::Span CaptureKeywords(Arena& a, const RE::BGSKeywordForm* form) {
+        Arena::Span span{(std::uint32_t)a.keywordBuffer.size(), form->numKeywords};
+        a.keywordBuffer.insert(a.keywordBuffer.end(), form->keywords, form->keywords + form->numKeywords);
+        return span;
     }
 
-    auto objSrc = dataHandler->LookupForm(jsonSrcId.GetUint(), jsonSrcFile.GetString());
-    if (!objSrc) return true;
+    // Records an item as it is before its first change, later captures are ignored
+    void CaptureOriginal(RE::TESBoundObject* item) {
+        auto& a = g_Data.originals;
+        if (a.Find(item) != Arena::kNone) return;
+
+        auto r = a.Add(item);
+        if (auto armor = item->As<RE::TESObjectARMO>()) {
+            a.rating[r] = armor->armorRating;
+            a.armorType[r] = armor->bipedModelData.armorType.underlying();
+            a.weight[r] = armor->weight;
+            a.value[r] = armor->value;
+            a.keywords[r] = CaptureKeywords(a, armor);
+        } else if (auto weap = item->As<RE::TESObjectWEAP>()) {
+            a.rating[r] = weap->attackDamage;
+            a.damage[r] = weap->criticalData.damage;
+            a.critMult[r] = weap->criticalData.prcntMult;
+            a.speed[r] = weap->weaponData.speed;
+            a.stagger[r] = weap->weaponData.staggerValue;
+            a.weight[r] = weap->weight;
+            a.value[r] = weap->value;
+            a.keywords[r] = CaptureKeywords(a, weap);
+        } else if (auto ammo = item->As<RE::TESAmmo>()) {
+            a.damage[r] = ammo->GetRuntimeData().data.damage;
+            a.value[r] = ammo->value;
+            a.keywords[r] = CaptureKeywords(a, ammo->AsKeywordForm());
+        }
 
-    auto boSrc = objSrc->As<RE::TESBoundObject>();
-    if (!boSrc) {
-        logger::info("Item wrong type {}:{:#08x}", objSrc->GetFile(0)->fileName, objSrc->GetLocalFormID());
-        return false;
+        // Both indexes are captured back to back, so the row's recipes stay one contiguous span
+        auto temper = CaptureRecipes(a, g_Data.temperRecipes, item);
+        auto craft = CaptureRecipes(a, g_Data.craftRecipes, item);
+        a.recipes[r] = {temper.start, temper.count + craft.count};
     }
 
-    float weight = 1.0f;
+    void RestoreKeywords(RE::BGSKeywordForm* form, std::span<RE::BGSKeyword* const> keywords) {
+        std::vector<RE::BGSKeyword*> kwds(keywords.begin(), keywords.end());
+        MatchKeywords(form, kwds, [](RE::BGSKeyword*) { return true; });
+    }
+
+    void RestoreRecipe(const Arena& a, const Arena::Recipe& r) {
+        auto tar = r.recipe;
+
+        auto& mats = tar->requiredItems;
+        if (mats.containerObjects) {
+            for (unsigned int i = 0; i < mats.numContainerObjects; i++) delete mats.containerObjects[i];
+            RE::free(mats.containerObjects);
+        }
+        mats.containerObjects = nullptr;
+        mats.numContainerObjects = 0;
+
+        if (r.mats.count) {
+            mats.containerObjects = RE::calloc<RE::ContainerObject*>(r.mats.count);
+            mats.numContainerObjects = r.mats.count;
+            for (std::uint32_t i = 0; i < r.mats.count; i++) {
+                const auto& m = a.matBuffer[r.mats.start + i];
+                mats.containerObjects[i] = new RE::ContainerObject(m.first, m.second);
+            }
+        }
 
-    if (&perm == &g_Config.permShared)
-        g_Data.modifiedItemsShared.insert(bo);
-    else
-        g_Data.modifiedItems.insert(bo);
+        for (auto head = tar->conditions.head; head;) {
+            auto next = head->next;
+            delete head;
+            head = next;
+        }
+        tar->conditions.head = nullptr;
+
+        RE::TESConditionItem* prev = nullptr;
+        for (std::uint32_t i = 0; i < r.conditions.count; i++) {
+            auto p = new RE::TESConditionItem();
+            p->data = a.conditionBuffer[r.conditions.start + i];
+            p->next = nullptr;
+
+            if (!prev)
+                tar->conditions.head = p;
+            else
+                prev->next = p;
+            prev = p;
+        }
+
+        tar->benchKeyword = r.bench;
+        tar->data.numConstructed = r.numConstructed;
+    }
+}
+
+bool QuickArmorRebalance::RevertChanges(RE::TESBoundObject* item) {
+    const auto& a = g_Data.originals;
+    auto r = a.Find(item);
+    if (r == Arena::kNone) return false;
 
     if (auto armor = item->As<RE::TESObjectARMO>()) {
-        auto src = objSrc->As<RE::TESObjectARMO>();
-        if (!src) return true;
+        armor->armorRating = a.rating[r];
+        armor->bipedModelData.armorType = (RE::BIPED_MODEL::ArmorType)a.armorType[r];
+        armor->weight = a.weight[r];
+        armor->value = a.value[r];
+        RestoreKeywords(armor, a.GetKeywords(r));
+
+        auto o = g_Data.itemStates.Find(armor);
+        if (o != ItemStates::kNone && (g_Data.itemStates.flags[o] & ItemStates::kSlotsOverridden)) {
+            armor->bipedModelData.bipedObjectSlots = (RE::BIPED_MODEL::BipedObjectSlot)g_Data.itemStates.origSlots[o];
+            g_Data.itemStates.flags[o] &= ~ItemStates::kSlotsOverridden;
+        }
+    } else if (auto weap = item->As<RE::TESObjectWEAP>()) {
+        weap->attackDamage = (std::uint16_t)a.rating[r];
+        weap->criticalData.damage = (std::uint16_t)a.damage[r];
+        weap->criticalData.prcntMult = a.critMult[r];
+        weap->weaponData.speed = a.speed[r];
+        weap->weaponData.staggerValue = a.stagger[r];
+        weap->weight = a.weight[r];
+        weap->value = a.value[r];
+        RestoreKeywords(weap, a.GetKeywords(r));
+    } else if (auto ammo = item->As<RE::TESAmmo>()) {
+        ammo->GetRuntimeData().data.damage = a.damage[r];
+        ammo->value = a.value[r];
+        RestoreKeywords(ammo->AsKeywordForm(), a.GetKeywords(r));
+    }
 
-        if (!changes.HasMember("w")) return false;
-        auto& jsonW = changes["w"];
+    for (const auto& recipe : a.GetRecipes(r)) RestoreRecipe(a, recipe);
 
-        if (!jsonW.IsFloat()) return false;
-        weight = jsonW.GetFloat();
+    // Recipes can't be removed from the game once added, so created ones are emptied and taken off every bench
+    if (auto it = g_Data.createdRecipes.find(item); it != g_Data.createdRecipes.end()) {
+        for (auto recipe : it->second) {
+            g_Data.temperRecipes.Remove(item, recipe);
+            g_Data.craftRecipes.Remove(item, recipe);
+            ::ClearRecipe(recipe);
+            recipe->benchKeyword = nullptr;
+        }
+        g_Data.createdRecipes.erase(it);
+    }
 
-        if (!ChangeField<RE::TESObjectARMO>(perm.bModifyArmorRating, "armor", changes, src, armor,
-                                            &RE::TESObjectARMO::armorRating,
-                                            [=](float f) { return std::max(1, (int)(weight * f)); }))
-            return false;
+    g_Data.modifiedItems.erase(item);
+    g_Data.modifiedItemsShared.erase(item);
+    g_Data.changeRound++;
+    return true;
+}
 
-        if (!ChangeField<RE::TESObjectARMO>(perm.bModifyWeight, "weight", changes, src, armor,
-                                            &RE::TESObjectARMO::weight, [=](float f) {
-                                                f *= weight;
-                                                if (g_Config.bRoundWeight)
-                                                    f = std::max(0.1f, 0.1f * std::round(10.0f * f));
-                                                return f;
-                                            }))
-            return false;
+namespace {
+    // One layer (shared or local) of the changes to a form, decoded from its json entry
+    struct ChangeLayer {
+        const rapidjson::Value* fields[kChangeFields] = {};  // Null where the entry doesn't have the member
+        const Permissions* perm = nullptr;
+        RE::TESBoundObject* src = nullptr;
+        float weight = 1.0f;
+        int rarity = -1;
+    };
 
-        if (!ChangeField<RE::TESObjectARMO>(perm.bModifyValue, "value", changes, src, armor, &RE::TESObjectARMO::value,
-                                            [=](float f) { return std::max(1, (int)(weight * f)); }))
-            return false;
+    // All the layers of changes to a form, resolved field by field so the form is only written once
+    struct ResolvedChange {
+        // The layer that decides a field: the last one that has it and is allowed to change it, same as when each
+        // layer was applied over the previous one
+        const ChangeLayer* Pick(bool Permissions::*allowed, ChangeField field = kNoField) const {
+            for (int i = nLayers - 1; i >= 0; i--) {
+                const auto& l = layers[i];
+                if (l.perm->*allowed && (field == kNoField || l.fields[field])) return &l;
+            }
+            return nullptr;
+        }
+
+        RE::TESBoundObject* item = nullptr;
+        ItemStates::Ordinal ordinal = ItemStates::kNone;
+        ChangeLayer layers[2];  // Shared, then local
+        int nLayers = 0;
+    };
 
-        if (perm.bModifySlots && changes.HasMember("slots")) {
-            auto& jsonOption = changes["slots"];
-            if (!jsonOption.IsUint()) return false;
+    enum class DecodeResult { kFailed, kNoChange, kDecoded };
 
-            if (!g_Data.modifiedArmorSlots.contains(armor))  // Don't overwrite previous
-                g_Data.modifiedArmorSlots[armor] = armor->bipedModelData.bipedObjectSlots.underlying();
-            armor->bipedModelData.bipedObjectSlots = (RE::BIPED_MODEL::BipedObjectSlot)jsonOption.GetUint();
+    DecodeResult DecodeLayer(const ResolvedChange& rc, const rapidjson::Value& changes, const Permissions& perm,
+                             ChangeLayer& layer, bool bMarkModified = true) {
+        auto item = rc.item;
+        if (!changes.IsObject()) return DecodeResult::kFailed;
+
+        layer = {};
+        layer.perm = &perm;
+        for (auto& i : changes.GetObj()) {
+            auto f = FindChangeField({i.name.GetString(), i.name.GetStringLength()});
+            if (f != kNoField && !layer.fields[f]) layer.fields[f] = &i.value;  // First one wins, same as FindMember
         }
 
-        if (perm.bModifyKeywords && changes.HasMember("keywords")) {
-            auto& jsonOption = changes["keywords"];
-            if (!jsonOption.IsBool()) return false;
+        auto jsonSrcFile = layer.fields[kFieldSrcFile];
+        auto jsonSrcId = layer.fields[kFieldSrcId];
 
-            if (jsonOption.GetBool()) {
-                logger::trace("Changing keywords");
-                armor->bipedModelData.armorType = src->bipedModelData.armorType;
+        if (!jsonSrcFile || !jsonSrcId || !jsonSrcFile->IsString() || !jsonSrcId->IsUint())
+            return DecodeResult::kFailed;
 
-                std::vector<RE::BGSKeyword*> addKwds;
+        auto objSrc = RE::TESDataHandler::GetSingleton()->LookupForm(jsonSrcId->GetUint(), jsonSrcFile->GetString());
+        if (!objSrc) return DecodeResult::kNoChange;
 
-                GetMatchingKeywords(g_Config.kwSet, addKwds, src);
+        auto boSrc = objSrc->As<RE::TESBoundObject>();
+        if (!boSrc) {
+            logger::info("Item wrong type {}:{:#08x}", objSrc->GetFile(0)->fileName, objSrc->GetLocalFormID());
+            return DecodeResult::kFailed;
+        }
 
-                if ((unsigned int)src->GetSlotMask() & (unsigned int)armor->GetSlotMask()) {
-                    GetMatchingKeywords(g_Config.kwSlotSpecSet, addKwds, src);
+        if (bMarkModified) {
+            if (&perm == &g_Config.permShared)
+                g_Data.modifiedItemsShared.insert(rc.ordinal);
+            else
+                g_Data.modifiedItems.insert(rc.ordinal);
+
+            // Reloading the source's mod has to redo this one too
+            auto mod = item->GetFile(0);
+            if (auto srcMod = boSrc->GetFile(0); srcMod != mod) g_Data.changeSources[mod].insert(srcMod);
+        }
+
+        layer.src = boSrc;
+
+        if (item->As<RE::TESObjectARMO>()) {
+            if (!objSrc->As<RE::TESObjectARMO>()) return DecodeResult::kNoChange;
+
+            auto jsonW = layer.fields[kFieldW];
+            if (!jsonW || !jsonW->IsFloat()) return DecodeResult::kFailed;
+            layer.weight = jsonW->GetFloat();
+        } else if (item->As<RE::TESObjectWEAP>()) {
+            if (!objSrc->As<RE::TESObjectWEAP>()) return DecodeResult::kNoChange;
+        } else if (item->As<RE::TESAmmo>()) {
+            if (!objSrc->As<RE::TESAmmo>()) return DecodeResult::kNoChange;
+        }
+
+        if (perm.bDistributeLoot && layer.fields[kFieldLoot]) {
+            auto& jsonLoot = *layer.fields[kFieldLoot];
+            if (!jsonLoot.IsObject()) return DecodeResult::kFailed;
+
+            if (jsonLoot.HasMember("rarity") && jsonLoot["rarity"].IsInt()) layer.rarity = jsonLoot["rarity"].GetInt();
+        }
+
+        return DecodeResult::kDecoded;
+    }
+
+    // The keyword option only does something when true, so a later layer turning it off doesn't undo an earlier one
+    const ChangeLayer* PickKeywords(const ResolvedChange& rc, bool& bValid) {
+        bValid = true;
+        for (int i = rc.nLayers - 1; i >= 0; i--) {
+            const auto& l = rc.layers[i];
+            if (!l.perm->bModifyKeywords || !l.fields[kFieldKeywords]) continue;
+
+            auto& jsonOption = *l.fields[kFieldKeywords];
+            if (!jsonOption.IsBool()) {
+                bValid = false;
+                return nullptr;
+            }
+            if (jsonOption.GetBool()) return &l;
+        }
+        return nullptr;
+    }
+
+    // The stat columns filled from, and written back to, the forms of the changed items
+    class StatBatch : public StatColumns
+    {
+    public:
+        // Adds a row for the change, false if one of its stat fields is malformed
+        bool Gather(const ResolvedChange& rc) {
+            auto r = AddRow();
+
+            if (!rc.nLayers) return true;
+
+            bool bValid = true;
+            auto set = [&](Field f, bool Permissions::*allowed, ChangeField field, auto get) {
+                auto l = rc.Pick(allowed, field);
+                if (!l) return;
+
+                auto& jsonScale = *l->fields[field];
+                if (!jsonScale.IsFloat()) {
+                    bValid = false;
+                    return;
                 }
 
-                MatchKeywords(armor, addKwds, [](RE::BGSKeyword* kw) {
-                    return g_Config.kwSet.contains(kw) || g_Config.kwSlotSpecSet.contains(kw);
-                });
+                Set(r, f, (float)get(l->src), jsonScale.GetFloat(), l->weight);
+            };
+
+            if (rc.item->As<RE::TESObjectARMO>()) {
+                set(kArmorRating, &Permissions::bModifyArmorRating, kFieldArmor,
+                    [](auto src) { return src->As<RE::TESObjectARMO>()->armorRating; });
+                set(kWeight, &Permissions::bModifyWeight, kFieldWeight,
+                    [](auto src) { return src->As<RE::TESObjectARMO>()->weight; });
+                set(kValue, &Permissions::bModifyValue, kFieldValue,
+                    [](auto src) { return src->As<RE::TESObjectARMO>()->value; });
+            } else if (rc.item->As<RE::TESObjectWEAP>()) {
+                set(kWeapDamage, &Permissions::bModifyWeapDamage, kFieldDamage,
+                    [](auto src) { return src->As<RE::TESObjectWEAP>()->attackDamage; });
+                set(kCritDamage, &Permissions::bModifyWeapDamage, kFieldDamage,
+                    [](auto src) { return src->As<RE::TESObjectWEAP>()->criticalData.damage; });
+                set(kWeight, &Permissions::bModifyWeapWeight, kFieldWeight,
+                    [](auto src) { return src->As<RE::TESObjectWEAP>()->weight; });
+                set(kSpeed, &Permissions::bModifyWeapSpeed, kFieldSpeed,
+                    [](auto src) { return src->As<RE::TESObjectWEAP>()->weaponData.speed; });
+                set(kStagger, &Permissions::bModifyWeapStagger, kFieldStagger,
+                    [](auto src) { return src->As<RE::TESObjectWEAP>()->weaponData.staggerValue; });
+                set(kValue, &Permissions::bModifyValue, kFieldValue,
+                    [](auto src) { return src->As<RE::TESObjectWEAP>()->value; });
+            } else if (rc.item->As<RE::TESAmmo>()) {
+                set(kAmmoDamage, &Permissions::bModifyWeapDamage, kFieldDamage,
+                    [](auto src) { return src->As<RE::TESAmmo>()->GetRuntimeData().data.damage; });
+                set(kValue, &Permissions::bModifyValue, kFieldValue,
+                    [](auto src) { return src->As<RE::TESAmmo>()->value; });
+            }
+
+            if (!bValid) Unset(r);
+            return bValid;
+        }
+
+        void Compute() { StatColumns::Compute(g_Config.bRoundWeight); }
+
+        void Scatter(std::size_t r, RE::TESBoundObject* item) const {
+            if (auto armor = item->As<RE::TESObjectARMO>()) {
+                if (auto v = Get(r, kArmorRating)) armor->armorRating = (std::uint32_t)*v;
+                if (auto v = Get(r, kWeight)) armor->weight = *v;
+                if (auto v = Get(r, kValue)) armor->value = (std::int32_t)*v;
+            } else if (auto weap = item->As<RE::TESObjectWEAP>()) {
+                if (auto v = Get(r, kWeapDamage)) weap->attackDamage = (std::uint16_t)*v;
+                if (auto v = Get(r, kCritDamage)) weap->criticalData.damage = (std::uint16_t)*v;
+                if (auto v = Get(r, kWeight)) weap->weight = *v;
+                if (auto v = Get(r, kSpeed)) weap->weaponData.speed = *v;
+                if (auto v = Get(r, kStagger)) weap->weaponData.staggerValue = *v;
+                if (auto v = Get(r, kValue)) weap->value = (std::int32_t)*v;
+            } else if (auto ammo = item->As<RE::TESAmmo>()) {
+                if (auto v = Get(r, kAmmoDamage)) ammo->GetRuntimeData().data.damage = *v;
+                if (auto v = Get(r, kValue)) ammo->value = (std::int32_t)*v;
             }
         }
-    } else if (auto weap = item->As<RE::TESObjectWEAP>()) {
-        auto src = objSrc->As<RE::TESObjectWEAP>();
-        if (!src) return true;
+    };
 
-        if (!ChangeField<RE::TESObjectWEAP>(perm.bModifyWeapDamage, "damage", changes, src, weap,
-                                            &RE::TESObjectWEAP::attackDamage,
-                                            [=](float f) { return (uint16_t)std::max(1, (int)f); }))
-            return false;
+    // Works out what each layer would have done to the item's recipes in turn, then does it once: at most one
+    // recipe creation, one replacement from the last layer that replaces, and disabling if that still applies after
+    bool ApplyRecipeChanges(const ResolvedChange& rc, ChangeField field, RecipeIndex& index,
+                            Permissions::RecipePermissions Permissions::*recipePerm, bool bCraft) {
+        auto item = rc.item;
 
-        if (!ChangeField<RE::TESObjectWEAP::CriticalData>(perm.bModifyWeapDamage, "damage", changes, &src->criticalData,
-                                                          &weap->criticalData, &RE::TESObjectWEAP::CriticalData::damage,
-                                                          [=](float f) { return (uint16_t)std::max(1, (int)f); }))
-            return false;
-        if (perm.bModifyWeapDamage) weap->criticalData.prcntMult = src->criticalData.prcntMult;
-
-        if (!ChangeField<RE::TESObjectWEAP>(perm.bModifyWeapWeight, "weight", changes, src, weap,
-                                            &RE::TESObjectWEAP::weight, [=](float f) {
-                                                f *= weight;
-                                                if (g_Config.bRoundWeight)
-                                                    f = std::max(0.1f, 0.1f * std::round(10.0f * f));
-                                                return f;
-                                            }))
-            return false;
+        const ChangeLayer* createLayer = nullptr;
+        const ChangeLayer* replaceLayer = nullptr;
+        bool bDisable = false;
+        bool bHasRecipe = index.Find(item) != nullptr;
 
-        if (!ChangeField<RE::TESObjectWEAP::Data>(perm.bModifyWeapSpeed, "speed", changes, &src->weaponData,
-                                                  &weap->weaponData, &RE::TESObjectWEAP::Data::speed,
-                                                  [=](float f) { return f; }))
-            return false;
+        for (int i = 0; i < rc.nLayers; i++) {
+            const auto& l = rc.layers[i];
+            const auto& perm = l.perm->*recipePerm;
+            if (!perm.bModify || !l.fields[field]) continue;
 
-        if (!ChangeField<RE::TESObjectWEAP::Data>(perm.bModifyWeapStagger, "stagger", changes, &src->weaponData,
-                                                  &weap->weaponData, &RE::TESObjectWEAP::Data::staggerValue,
-                                                  [=](float f) { return f; }))
-            return false;
+            auto& jsonOpts = *l.fields[field];
+            if (!jsonOpts.IsObject()) return false;
 
-        if (!ChangeField<RE::TESObjectWEAP>(perm.bModifyValue, "value", changes, src, weap, &RE::TESObjectWEAP::value,
-                                            [=](float f) { return std::max(1, (int)f); }))
-            return false;
+            auto opts = jsonOpts.GetObj();
 
-        if (perm.bModifyKeywords && changes.HasMember("keywords")) {
-            auto& jsonOption = changes["keywords"];
-            if (!jsonOption.IsBool()) return false;
+            bool bNew = false;
+            bool bFree = false;
 
-            if (jsonOption.GetBool()) {
-                logger::trace("Changing keywords");
+            if (opts.HasMember("new")) bNew = opts["new"].GetBool();
+            if (opts.HasMember("free")) bFree = opts["free"].GetBool();
 
-                std::vector<RE::BGSKeyword*> addKwds;
+            auto recipesSrc = index.Find(l.src);
+            bFree = (bFree && l.perm->crafting.bFree) || recipesSrc;  // If recipe source, free doesn't matter
 
-                GetMatchingKeywords(g_Config.kwSetWeap, addKwds, src);
-                MatchKeywords(weap, addKwds, [](RE::BGSKeyword* kw) { return g_Config.kwSetWeap.contains(kw); });
+            if (bCraft && l.rarity > g_Config.craftingRarityMax) {
+                if (g_Config.bDisableCraftingRecipesOnRarity && bHasRecipe) bDisable = true;
+                continue;
+            }
+
+            if (!bHasRecipe && bNew && perm.bCreate && bFree) {
+                createLayer = &l;
+                bHasRecipe = true;
+            }
+
+            if (bHasRecipe && bFree) {
+                replaceLayer = &l;
+                if (recipesSrc) bDisable = false;  // Replacing sets the bench again
             }
         }
-    } else if (auto ammo = item->As<RE::TESAmmo>()) {
-        auto src = objSrc->As<RE::TESAmmo>();
-        if (!src) return true;
 
-        if (!ChangeField<RE::AMMO_DATA>(perm.bModifyWeapDamage, "damage", changes, &src->GetRuntimeData().data,
-                                        &ammo->GetRuntimeData().data, &RE::AMMO_DATA::damage,
-                                        [=](float f) { return std::max(1.0f, f); }))
-            return false;
+        if (createLayer) {
+            auto recipesSrc = index.Find(createLayer->src);
+            RE::BGSConstructibleObject* recipeSrc = recipesSrc ? recipesSrc->front() : nullptr;
 
-        if (!ChangeField<RE::TESAmmo>(perm.bModifyValue, "value", changes, src, ammo, &RE::TESAmmo::value,
-                                      [=](float f) { return std::max(1, (int)f); }))
-            return false;
+            auto newForm = static_cast<RE::BGSConstructibleObject*>(
+                RE::IFormFactory::GetFormFactoryByType(RE::FormType::ConstructibleObject)->Create());
+
+            if (newForm) {
+                if (recipeSrc)
+                    newForm->benchKeyword = recipeSrc->benchKeyword;
+                else if (bCraft)
+                    newForm->benchKeyword = RE::TESForm::LookupByEditorID<RE::BGSKeyword>("CraftingSmithingForge");
+                else
+                    newForm->benchKeyword =
+                        item->As<RE::TESObjectARMO>()
+                            ? RE::TESForm::LookupByEditorID<RE::BGSKeyword>("CraftingSmithingArmorTable")
+                            : RE::TESForm::LookupByEditorID<RE::BGSKeyword>("CraftingSmithingSharpeningWheel");
+                newForm->createdItem = item;
+                newForm->data.numConstructed = bCraft && item->As<RE::TESAmmo>() ? 24 : 1;
+
+                RE::TESDataHandler::GetSingleton()->GetFormArray<RE::BGSConstructibleObject>().push_back(
+                    newForm);  // For whatever reason, it's not added automatically and thus won't show up in game
+                index.Add(item, newForm);
+                g_Data.createdRecipes[item].push_back(newForm);
+            }
+        }
+
+        auto recipesItem = index.Find(item);
+        if (!recipesItem) return true;
+
+        if (replaceLayer) ::ReplaceRecipes(*recipesItem, index.Find(replaceLayer->src), replaceLayer->weight);
+
+        if (bDisable) {
+            logger::trace("Disabling recipes for {}", item->GetName());
+            for (auto i : *recipesItem) i->benchKeyword = nullptr;
+        }
+
+        return true;
+    }
+
+    // The stats come from the batch the change was gathered into, everything else is read from the change here
+    bool ApplyResolvedChange(const ResolvedChange& rc, const StatBatch& stats, std::size_t row) {
+        auto item = rc.item;
+        bool bValid = true;
+
+        CaptureOriginal(item);
+        g_Data.changeRound++;
+        stats.Scatter(row, item);
 
-        if (perm.bModifyKeywords && changes.HasMember("keywords")) {
-            auto& jsonOption = changes["keywords"];
-            if (!jsonOption.IsBool()) return false;
+        if (auto armor = item->As<RE::TESObjectARMO>()) {
+            if (auto l = rc.Pick(&Permissions::bModifySlots, kFieldSlots)) {
+                auto& jsonOption = *l->fields[kFieldSlots];
+                if (!jsonOption.IsUint()) return false;
+
+                auto& states = g_Data.itemStates;
+                if (!(states.Get(rc.ordinal) & ItemStates::kSlotsOverridden))  // Don't overwrite previous
+                    states.SetOriginalSlots(rc.ordinal, armor->bipedModelData.bipedObjectSlots.underlying());
+                armor->bipedModelData.bipedObjectSlots = (RE::BIPED_MODEL::BipedObjectSlot)jsonOption.GetUint();
+            }
 
-            if (jsonOption.GetBool()) {
+            if (auto l = PickKeywords(rc, bValid)) {
                 logger::trace("Changing keywords");
+                auto src = l->src->As<RE::TESObjectARMO>();
+                armor->bipedModelData.armorType = src->bipedModelData.armorType;
 
                 std::vector<RE::BGSKeyword*> addKwds;
 
-                GetMatchingKeywords(g_Config.kwSetWeap, addKwds, src->AsKeywordForm());
+                GetMatchingKeywords(g_Config.kwSet, addKwds, src);
+
+                if ((unsigned int)src->GetSlotMask() & (unsigned int)armor->GetSlotMask()) {
+                    GetMatchingKeywords(g_Config.kwSlotSpecSet, addKwds, src);
+                }
+
+                MatchKeywords(armor, addKwds, [](RE::BGSKeyword* kw) {
+                    return g_Config.kwSet.contains(kw) || g_Config.kwSlotSpecSet.contains(kw);
+                });
+            }
+            if (!bValid) return false;
+        } else if (auto weap = item->As<RE::TESObjectWEAP>()) {
+            if (auto l = rc.Pick(&Permissions::bModifyWeapDamage))
+                weap->criticalData.prcntMult = l->src->As<RE::TESObjectWEAP>()->criticalData.prcntMult;
+
+            if (auto l = PickKeywords(rc, bValid)) {
+                logger::trace("Changing keywords");
+
+                std::vector<RE::BGSKeyword*> addKwds;
+
+                GetMatchingKeywords(g_Config.kwSetWeap, addKwds, l->src->As<RE::TESObjectWEAP>());
+                MatchKeywords(weap, addKwds, [](RE::BGSKeyword* kw) { return g_Config.kwSetWeap.contains(kw); });
+            }
+            if (!bValid) return false;
+        } else if (auto ammo = item->As<RE::TESAmmo>()) {
+            if (auto l = PickKeywords(rc, bValid)) {
+                logger::trace("Changing keywords");
+
+                std::vector<RE::BGSKeyword*> addKwds;
+
+                GetMatchingKeywords(g_Config.kwSetWeap, addKwds, l->src->As<RE::TESAmmo>()->AsKeywordForm());
                 MatchKeywords(ammo->AsKeywordForm(), addKwds,
                               [](RE::BGSKeyword* kw) { return g_Config.kwSetWeap.contains(kw); });
             }
+            if (!bValid) return false;
         }
-    }
-
-    int rarity = -1;
-    if (perm.bDistributeLoot) {
-        if (changes.HasMember("loot")) {
-            auto& jsonLoot = changes["loot"];
-            if (!jsonLoot.IsObject()) return false;
 
-            if (jsonLoot.HasMember("rarity") && jsonLoot["rarity"].IsInt()) rarity = jsonLoot["rarity"].GetInt();
+        // Loot entries only fill in a table, so each layer can simply overwrite the last
+        if (g_Data.loot) {
+            for (int i = 0; i < rc.nLayers; i++) {
+                const auto& l = rc.layers[i];
+                if (l.perm->bDistributeLoot && l.fields[kFieldLoot]) LoadLootChanges(item, *l.fields[kFieldLoot]);
+            }
+        }
 
-            if (g_Data.loot) LoadLootChanges(bo, jsonLoot);
+        if (!item->As<RE::TESAmmo>()) {
+            if (!ApplyRecipeChanges(rc, kFieldTemper, g_Data.temperRecipes, &Permissions::temper, false)) return false;
         }
-    }
+        if (!ApplyRecipeChanges(rc, kFieldCraft, g_Data.craftRecipes, &Permissions::crafting, true)) return false;
 
-    if (perm.temper.bModify && changes.HasMember("temper") && !item->As<RE::TESAmmo>()) {
-        auto& jsonOpts = changes["temper"];
-        if (!jsonOpts.IsObject()) return false;
+        return true;
+    }
 
-        auto opts = jsonOpts.GetObj();
+    RE::TESBoundObject* LookupChangedItem(const RE::TESFile* file, RE::FormID id) {
+        auto item = RE::TESForm::LookupByID(GetFullId(file, id));
+        if (!item) {
+            logger::info("Item not found {}:{:#08x}", file->fileName, id);
+            return nullptr;
+        }
 
-        bool bNew = false;
-        bool bFree = false;
+        auto bo = item->As<RE::TESBoundObject>();
+        if (!bo) {
+            logger::info("Item wrong type {}:{:#08x}", file->fileName, id);
+            return nullptr;
+        }
+        return bo;
+    }
 
-        if (opts.HasMember("new")) bNew = opts["new"].GetBool();
-        if (opts.HasMember("free")) bFree = opts["free"].GetBool();
+    // Stats are worked out a batch at a time. A batch is cut short when a change's source is already in it, so the
+    // source's stats are read after its own change, same as applying one at a time. It is also cut at a fixed size,
+    // which bounds how many entries have to be kept alive when they're fed in while a file is still being read
+    class BatchedChangeApplier : public ChangeApplier {
+    public:
+        static constexpr int kLayers = 2;
+        static constexpr std::size_t kMaxBatch = 256;
+
+        BatchedChangeApplier(const RE::TESFile* file) : file(file) { pending.reserve(kMaxBatch); }
+
+        void Add(RE::FormID id, const rapidjson::Value* shared, const rapidjson::Value* local,
+                 std::shared_ptr<void> owner) override {
+            const rapidjson::Value* values[] = {shared, local};
+            const Permissions* perms[] = {&g_Config.permShared, &g_Config.permLocal};
+
+            Pending p{id, std::move(owner)};
+            auto& rc = p.rc;
+            rc.item = LookupChangedItem(file, id);
+            if (rc.item) rc.ordinal = g_Data.itemStates.Track(rc.item);
+
+            for (int n = 0; n < kLayers; n++) {
+                if (!values[n]) continue;
+
+                auto r = rc.item ? DecodeLayer(rc, *values[n], *perms[n], rc.layers[rc.nLayers])
+                                 : DecodeResult::kFailed;
+                if (r == DecodeResult::kFailed) {
+                    logger::error("Failed to apply changes to {}:{:#08x}", file->fileName, id);
+                    continue;
+                }
 
-        RE::BGSConstructibleObject *recipeItem = nullptr, *recipeSrc = nullptr;
+                p.bCounted[n] = true;
+                if (r == DecodeResult::kDecoded) rc.nLayers++;
+            }
 
-        auto it = g_Data.temperRecipe.find(bo);
-        if (it != g_Data.temperRecipe.end()) recipeItem = it->second;
+            bool bCut = pending.size() >= kMaxBatch;
+            for (int n = 0; n < rc.nLayers && !bCut; n++) bCut = batchItems.contains(rc.layers[n].src);
+            if (bCut) ApplyBatch();
 
-        it = g_Data.temperRecipe.find(boSrc);
-        if (it != g_Data.temperRecipe.end()) recipeSrc = it->second;
+            p.bValid = batch.Gather(rc);
+            if (rc.item) batchItems.insert(rc.item);
+            pending.push_back(std::move(p));
+        }
 
-        bFree = (bFree && perm.crafting.bFree) || recipeSrc;  // If recipe source, free doesn't matter
+        void Flush() override { ApplyBatch(); }
 
-        if (!recipeItem && bNew && perm.temper.bCreate && bFree) {
-            auto newForm = static_cast<RE::BGSConstructibleObject*>(
-                RE::IFormFactory::GetFormFactoryByType(RE::FormType::ConstructibleObject)->Create());
+        void Finish(bool bShared, bool bLocal) override {
+            ApplyBatch();
+            if (bShared) FinishFileChanges(file, nChanges[0], g_Config.permShared);
+            if (bLocal) FinishFileChanges(file, nChanges[1], g_Config.permLocal);
+        }
 
-            if (newForm) {
-                newForm->benchKeyword =
-                    recipeSrc
-                        ? recipeSrc->benchKeyword
-                        : (item->As<RE::TESObjectARMO>()
-                               ? RE::TESForm::LookupByEditorID<RE::BGSKeyword>("CraftingSmithingArmorTable")
-                               : RE::TESForm::LookupByEditorID<RE::BGSKeyword>("CraftingSmithingSharpeningWheel"));
-                newForm->createdItem = item;
-                newForm->data.numConstructed = 1;
+    private:
+        struct Pending {
+            RE::FormID id;
+            std::shared_ptr<void> owner;
+            ResolvedChange rc;
+            bool bCounted[kLayers] = {};
+            bool bValid = true;
+        };
+
+        void ApplyBatch() {
+            batch.Compute();
+            for (std::size_t i = 0; i < pending.size(); i++) {
+                const auto& p = pending[i];
+                if (p.rc.nLayers && (!p.bValid || !ApplyResolvedChange(p.rc, batch, i))) {
+                    logger::error("Failed to apply changes to {}:{:#08x}", file->fileName, p.id);
+                    continue;
+                }
 
-                dataHandler->GetFormArray<RE::BGSConstructibleObject>().push_back(
-                    newForm);  // For whatever reason, it's not added automatically and thus won't show up in game
-                g_Data.temperRecipe.insert({bo, recipeItem});
-                recipeItem = newForm;
+                for (int n = 0; n < kLayers; n++) nChanges[n] += p.bCounted[n];
             }
+
+            pending.clear();
+            batch.Clear();
+            batchItems.clear();
         }
 
-        if (recipeItem && bFree) ::ReplaceRecipe(recipeItem, recipeSrc, weight);
+        const RE::TESFile* file;
+        std::vector<Pending> pending;
+        StatBatch batch;
+        std::unordered_set<RE::TESBoundObject*> batchItems;
+        int nChanges[kLayers] = {};
+    };
+}
+
+std::unique_ptr<QuickArmorRebalance::ChangeApplier> QuickArmorRebalance::MakeChangeApplier(const RE::TESFile* file) {
+    return std::make_unique<BatchedChangeApplier>(file);
+}
+
+RE::TESBoundObject* QuickArmorRebalance::GetChangeSource(const rapidjson::Value& changes) {
+    if (!changes.IsObject()) return nullptr;
+
+    auto jsonSrcFile = changes.FindMember("srcfile");
+    auto jsonSrcId = changes.FindMember("srcid");
+    if (jsonSrcFile == changes.MemberEnd() || jsonSrcId == changes.MemberEnd()) return nullptr;
+    if (!jsonSrcFile->value.IsString() || !jsonSrcId->value.IsUint()) return nullptr;
+
+    auto objSrc =
+        RE::TESDataHandler::GetSingleton()->LookupForm(jsonSrcId->value.GetUint(), jsonSrcFile->value.GetString());
+    return objSrc ? objSrc->As<RE::TESBoundObject>() : nullptr;
+}
+
+bool QuickArmorRebalance::ApplyChanges(const RE::TESFile* file, RE::FormID id, const rapidjson::Value& changes,
+                                       const Permissions& perm) {
+    ResolvedChange rc;
+    rc.item = LookupChangedItem(file, id);
+    if (!rc.item) return false;
+    rc.ordinal = g_Data.itemStates.Track(rc.item);
+
+    switch (DecodeLayer(rc, changes, perm, rc.layers[0])) {
+        case DecodeResult::kFailed:
+            return false;
+        case DecodeResult::kNoChange:
+            return true;
+        case DecodeResult::kDecoded:
+            rc.nLayers = 1;
+            break;
     }
 
-    if (perm.crafting.bModify && changes.HasMember("craft")) {
-        auto& jsonOpts = changes["craft"];
-        if (!jsonOpts.IsObject()) return false;
+    StatBatch batch;
+    if (!batch.Gather(rc)) return false;
+    batch.Compute();
 
-        auto opts = jsonOpts.GetObj();
+    return ApplyResolvedChange(rc, batch, 0);
+}
 
-        bool bNew = false;
-        bool bFree = false;
+namespace {
+    int RecipeCost(const RE::BGSConstructibleObject* recipe, float w = 1.0f) {
+        int n = 0;
+        const auto& mats = recipe->requiredItems;
+        for (unsigned int i = 0; i < mats.numContainerObjects; i++)
+            n += std::max(1, (int)(w * mats.containerObjects[i]->count));
+        return n;
+    }
 
-        if (opts.HasMember("new")) bNew = opts["new"].GetBool();
-        if (opts.HasMember("free")) bFree = opts["free"].GetBool();
+    int RecipeCost(const RecipeIndex& index, RE::TESBoundObject* item) {
+        auto recipes = index.Find(item);
+        if (!recipes || !recipes->front()->benchKeyword) return -1;
+        return RecipeCost(recipes->front());
+    }
 
-        RE::BGSConstructibleObject *recipeItem = nullptr, *recipeSrc = nullptr;
+    ItemPreview::Stats GetStats(RE::TESBoundObject* item) {
+        ItemPreview::Stats s;
+        if (auto armor = item->As<RE::TESObjectARMO>()) {
+            s.rating = armor->armorRating / 100.0f;
+            s.weight = armor->weight;
+            s.value = armor->value;
+        } else if (auto weap = item->As<RE::TESObjectWEAP>()) {
+            s.rating = weap->attackDamage;
+            s.weight = weap->weight;
+            s.speed = weap->weaponData.speed;
+            s.stagger = weap->weaponData.staggerValue;
+            s.value = weap->value;
+        } else if (auto ammo = item->As<RE::TESAmmo>()) {
+            s.rating = ammo->GetRuntimeData().data.damage;
+            s.value = ammo->value;
+        }
 
-        auto it = g_Data.craftRecipe.find(bo);
-        if (it != g_Data.craftRecipe.end()) recipeItem = it->second;
+        s.temperCost = RecipeCost(g_Data.temperRecipes, item);
+        s.craftCost = RecipeCost(g_Data.craftRecipes, item);
+        return s;
+    }
 
-        it = g_Data.craftRecipe.find(boSrc);
-        if (it != g_Data.craftRecipe.end()) recipeSrc = it->second;
+    // What ApplyRecipeChanges would leave as the item's first recipe, for a single layer
+    int PreviewRecipeCost(const ChangeLayer& l, RE::TESBoundObject* item, ChangeField field, const RecipeIndex& index,
+                          Permissions::RecipePermissions Permissions::*recipePerm, bool bCraft, int before) {
+        const auto& perm = l.perm->*recipePerm;
+        if (!perm.bModify || !l.fields[field]) return before;
 
-        bFree = (bFree && perm.crafting.bFree) || recipeSrc;  // If recipe source, free doesn't matter
+        auto& jsonOpts = *l.fields[field];
+        if (!jsonOpts.IsObject()) return before;
 
-        if (rarity <= g_Config.craftingRarityMax) {
-            if (!recipeItem && bNew && perm.crafting.bCreate && bFree) {
-                auto newForm = static_cast<RE::BGSConstructibleObject*>(
-                    RE::IFormFactory::GetFormFactoryByType(RE::FormType::ConstructibleObject)->Create());
+        bool bNew = jsonOpts.HasMember("new") && jsonOpts["new"].GetBool();
+        bool bFree = jsonOpts.HasMember("free") && jsonOpts["free"].GetBool();
 
-                if (newForm) {
-                    newForm->benchKeyword =
-                        recipeSrc ? recipeSrc->benchKeyword
-                                  : RE::TESForm::LookupByEditorID<RE::BGSKeyword>("CraftingSmithingForge");
-                    newForm->createdItem = item;
-                    newForm->data.numConstructed = item->As<RE::TESAmmo>() ? 24 : 1;
-
-                    dataHandler->GetFormArray<RE::BGSConstructibleObject>().push_back(
-                        newForm);  // For whatever reason, it's not added automatically and thus won't show up in game
-                    g_Data.craftRecipe.insert({bo, recipeItem});
-                    recipeItem = newForm;
+        auto recipesSrc = index.Find(l.src);
+        auto recipesItem = index.Find(item);
+        bFree = (bFree && l.perm->crafting.bFree) || recipesSrc;
+
+        if (bCraft && l.rarity > g_Config.craftingRarityMax)
+            return g_Config.bDisableCraftingRecipesOnRarity && recipesItem ? -1 : before;
+
+        if (!bFree || (!recipesItem && !(bNew && perm.bCreate))) return before;
+        if (!recipesSrc) return 0;  // Replaced by an empty recipe
+
+        auto recipeSrc = recipesSrc->front();
+        if (recipesItem) {
+            auto tar = recipesItem->front();
+            for (auto j : *recipesSrc) {
+                if (j->benchKeyword == tar->benchKeyword) {
+                    recipeSrc = j;
+                    break;
                 }
             }
+            if (recipeSrc == tar) return before;
+        }
 
-            if (recipeItem && bFree) ::ReplaceRecipe(recipeItem, recipeSrc, weight);
-        } else if (g_Config.bDisableCraftingRecipesOnRarity && recipeItem) {
-            logger::trace("Disabling recipe for {}", item->GetName());
-            recipeItem->benchKeyword = nullptr;
+        return RecipeCost(recipeSrc, l.weight);
+    }
+
+    void PreviewChange(const ChangeLayer& l, const StatBatch& stats, std::size_t row, ItemPreview& p) {
+        auto& a = p.after;
+        if (p.item->As<RE::TESObjectARMO>()) {
+            if (auto v = stats.Get(row, StatBatch::kArmorRating)) a.rating = *v / 100.0f;
+        } else if (p.item->As<RE::TESObjectWEAP>()) {
+            if (auto v = stats.Get(row, StatBatch::kWeapDamage)) a.rating = *v;
+            if (auto v = stats.Get(row, StatBatch::kSpeed)) a.speed = *v;
+            if (auto v = stats.Get(row, StatBatch::kStagger)) a.stagger = *v;
+        } else if (p.item->As<RE::TESAmmo>()) {
+            if (auto v = stats.Get(row, StatBatch::kAmmoDamage)) a.rating = *v;
         }
+        if (auto v = stats.Get(row, StatBatch::kWeight)) a.weight = *v;
+        if (auto v = stats.Get(row, StatBatch::kValue)) a.value = (int)*v;
+
+        auto item = p.item;
+        if (!item->As<RE::TESAmmo>())
+            a.temperCost = PreviewRecipeCost(l, item, kFieldTemper, g_Data.temperRecipes, &Permissions::temper, false,
+                                             p.before.temperCost);
+        a.craftCost = PreviewRecipeCost(l, item, kFieldCraft, g_Data.craftRecipes, &Permissions::crafting, true,
+                                        p.before.craftCost);
     }
 
-    return true;
+    std::uint64_t HashParams(const ArmorChangeParams& params) {
+        auto hash = HashFNV("");
+        auto add = [&](const auto& v) { hash = HashFNV({reinterpret_cast<const char*>(&v), sizeof(v)}, hash); };
+        auto addSlider = [&](const ArmorChangeParams::SliderPair& pair) {
+            add(pair.bModify);
+            add(pair.fScale);
+        };
+        auto addRecipe = [&](const ArmorChangeParams::RecipeOptions& opts) {
+            add(opts.bModify);
+            add(opts.bNew);
+            add(opts.bFree);
+        };
+
+        // Forms changing underneath, or the config options the stat math reads, invalidate a preview too
+        add(g_Data.changeRound);
+        add(g_Config.bRoundWeight);
+        add(g_Config.craftingRarityMax);
+        add(g_Config.bDisableCraftingRecipesOnRarity);
+
+        add(params.items.size());
+        for (auto i : params.items) add(i);
+        add(params.armorSet);
+        add(params.curve);
+        add(params.isWornArmor);
+        add(params.bModifyKeywords);
+        addSlider(params.armor.rating);
+        addSlider(params.armor.weight);
+        addSlider(params.weapon.damage);
+        addSlider(params.weapon.weight);
+        addSlider(params.weapon.speed);
+        addSlider(params.weapon.stagger);
+        addSlider(params.value);
+        addRecipe(params.temper);
+        addRecipe(params.craft);
+        add(params.distProfile);
+        add(params.rarity);
+        add(params.bDistribute);
+        for (const auto& i : params.mapArmorSlots) add(i);
+        return hash;
+    }
+}
+
+QuickArmorRebalance::ArmorChangesPreview QuickArmorRebalance::PreviewArmorChanges(const ArmorChangeParams& params,
+                                                                                  const RE::TESBoundObject* only) {
+    ArmorChangesPreview preview;
+    if (params.items.empty() || !params.armorSet || !params.curve) return preview;
+
+    ArenaDocument doc;
+    FileChanges mapFileChanges;
+    std::atomic<bool> bCancel = false;
+    std::atomic<std::size_t> nBuilt = 0;
+    BuildArmorChanges(params, mapFileChanges, doc.GetAllocator(), bCancel, nBuilt, only);
+
+    std::vector<ResolvedChange> changes;
+    changes.reserve(nBuilt);
+    for (auto& [file, fileChanges] : mapFileChanges) {
+        for (auto& i : fileChanges.GetObj()) {
+            auto item = RE::TESForm::LookupByID<RE::TESBoundObject>(GetFullId(file, atoi(i.name.GetString())));
+            if (!item) continue;
+
+            ResolvedChange rc;
+            rc.item = item;
+            if (DecodeLayer(rc, i.value, g_Config.permLocal, rc.layers[0], false) != DecodeResult::kDecoded) continue;
+            rc.nLayers = 1;
+            changes.push_back(rc);
+        }
+    }
+
+    // Nothing is applied, so every source is read as it is now and one batch covers everything
+    StatBatch batch;
+    for (const auto& rc : changes) batch.Gather(rc);
+    batch.Compute();
+
+    preview.reserve(changes.size());
+    for (std::size_t i = 0; i < changes.size(); i++) {
+        auto stats = GetStats(changes[i].item);
+        auto& p = preview.emplace_back(changes[i].item, stats, stats);
+        PreviewChange(changes[i].layers[0], batch, i, p);
+    }
+
+    return preview;
+}
+
+const QuickArmorRebalance::ItemPreview* QuickArmorRebalance::GetItemPreview(const ArmorChangeParams& params,
+                                                                           RE::TESBoundObject* item) {
+    static ArmorChangesPreview preview;
+    static std::uint64_t previewHash = 0;
+
+    auto hash = HashFNV({reinterpret_cast<const char*>(&item), sizeof(item)}, HashParams(params));
+    if (hash != previewHash) {
+        preview = PreviewArmorChanges(params, item);
+        previewHash = hash;
+    }
+    return preview.empty() ? nullptr : &preview.front();
 }
 
 void ::ClearRecipe(RE::BGSConstructibleObject* tar) {
@@ -860,3 +1503,22 @@ void ::ReplaceRecipe(RE::BGSConstructibleObject* tar, const RE::BGSConstructible
         }
     }
 }
+
+void ::ReplaceRecipes(const RecipeIndex::RecipeList& tar, const RecipeIndex::RecipeList* src, float w) {
+    for (auto i : tar) {
+        // Copy from the source recipe at the same bench when there is one, otherwise its primary recipe
+        const RE::BGSConstructibleObject* recipeSrc = nullptr;
+        if (src) {
+            recipeSrc = src->front();
+            for (auto j : *src) {
+                if (j->benchKeyword == i->benchKeyword) {
+                    recipeSrc = j;
+                    break;
+                }
+            }
+        }
+
+        if (recipeSrc == i) continue;  // Item is its own source, nothing to change
+        ::ReplaceRecipe(i, recipeSrc, w);
+    }
+}
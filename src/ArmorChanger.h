@@ -2,6 +2,7 @@
 
 #include "Data.h"
 #include "Config.h"
+#include "Tasks.h"
 
 #include <rapidjson/fwd.h>
 
@@ -9,7 +10,58 @@ namespace QuickArmorRebalance
 {
     ArmorSlots GetConvertableArmorSlots(const ArmorChangeParams& params);
     void MakeArmorChanges(const ArmorChangeParams& params);
+    std::unique_ptr<Task> MakeArmorChangesTask(const ArmorChangeParams& params);
 
-    void ApplyChanges(const RE::TESFile* file, const rapidjson::Value& ls, const Permissions& perm);
     bool ApplyChanges(const RE::TESFile* file, RE::FormID id, const rapidjson::Value& changes, const Permissions& perm);
+
+    // Applies a mod's changes a form at a time as they're fed in, for when they're read from a file as they arrive
+    class ChangeApplier {
+    public:
+        virtual ~ChangeApplier() = default;
+
+        // The form's entry in each layer, either can be null. Entries are applied a batch at a time, so they have to
+        // stay valid until then, which owner is kept around for
+        virtual void Add(RE::FormID id, const rapidjson::Value* shared, const rapidjson::Value* local,
+                         std::shared_ptr<void> owner = nullptr) = 0;
+
+        // Applies what is still pending now, for when something else is about to change or read the same forms
+        virtual void Flush() = 0;
+
+        // Applies what is still pending and logs the changes made from each layer that had a file
+        virtual void Finish(bool bShared, bool bLocal) = 0;
+    };
+
+    std::unique_ptr<ChangeApplier> MakeChangeApplier(const RE::TESFile* file);
+
+    // The item a change entry takes its stats from, null if it's missing or can't be found
+    RE::TESBoundObject* GetChangeSource(const rapidjson::Value& changes);
+
+    // Restores an item and its recipes to how they were before any changes were applied
+    bool RevertChanges(RE::TESBoundObject* item);
+
+    // An item's stats as they are now and as they would be after making changes with the same parameters
+    struct ItemPreview {
+        struct Stats {
+            float rating = 0.0f;  // Armor rating, or damage for weapons and ammo
+            float weight = 0.0f;
+            float speed = 0.0f;
+            float stagger = 0.0f;
+            int value = 0;
+            int temperCost = -1;  // Materials needed by the first recipe, -1 if there isn't one
+            int craftCost = -1;
+        };
+
+        RE::TESBoundObject* item = nullptr;
+        Stats before;
+        Stats after;
+    };
+
+    using ArmorChangesPreview = std::vector<ItemPreview>;
+
+    // Works out what MakeArmorChanges would do, without changing any forms or writing any files. With only set, just
+    // that item is previewed
+    ArmorChangesPreview PreviewArmorChanges(const ArmorChangeParams& params, const RE::TESBoundObject* only = nullptr);
+    // The preview of a single item, for showing as it's hovered. Only recomputed when the item, the parameters or any
+    // forms have changed since the last call, null if the changes would leave the item alone
+    const ItemPreview* GetItemPreview(const ArmorChangeParams& params, RE::TESBoundObject* item);
 }
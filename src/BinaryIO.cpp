@@ -0,0 +1,32 @@
+#include "BinaryIO.h"
+
+#include <fstream>
+
+std::uint64_t QuickArmorRebalance::HashFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return 0;
+
+    std::string data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    return HashFNV(data);
+}
+
+bool QuickArmorRebalance::BinaryWriter::Save(const std::filesystem::path& path) const {
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    file.write(data.data(), data.size());
+    return file.good();
+}
+
+bool QuickArmorRebalance::BinaryReader::Load(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+
+    data.resize((std::size_t)file.tellg());
+    file.seekg(0);
+    file.read(data.data(), data.size());
+    pos = 0;
+    return file.good();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Hashing and the byte streams the caches are written with. None of it touches the game, so it's tested on its own
+
+namespace QuickArmorRebalance {
+    constexpr std::uint64_t HashFNV(std::string_view str, std::uint64_t hash = 0xcbf29ce484222325ull) {
+        for (auto c : str) {
+            hash ^= (std::uint8_t)c;
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    // Hash of a file's contents, 0 if it can't be read
+    std::uint64_t HashFile(const std::filesystem::path& path);
+
+    class BinaryWriter {
+    public:
+        template <class T>
+            requires std::is_trivially_copyable_v<T>
+        void Write(const T& v) {
+            data.append(reinterpret_cast<const char*>(&v), sizeof(T));
+        }
+
+        void WriteString(std::string_view str) {
+            Write((std::uint32_t)str.size());
+            data.append(str);
+        }
+
+        bool Save(const std::filesystem::path& path) const;
+
+    private:
+        std::string data;
+    };
+
+    class BinaryReader {
+    public:
+        bool Load(const std::filesystem::path& path);
+
+        template <class T>
+            requires std::is_trivially_copyable_v<T>
+        bool Read(T& v) {
+            if (pos + sizeof(T) > data.size()) return false;
+            std::memcpy(&v, data.data() + pos, sizeof(T));
+            pos += sizeof(T);
+            return true;
+        }
+
+        bool ReadString(std::string& str) {
+            std::uint32_t len;
+            if (!Read(len) || pos + len > data.size()) return false;
+            str.assign(data.data() + pos, len);
+            pos += len;
+            return true;
+        }
+
+        bool AtEnd() const { return pos == data.size(); }
+
+    private:
+        std::string data;
+        std::size_t pos = 0;
+    };
+}
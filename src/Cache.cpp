@@ -0,0 +1,360 @@
+#include "Cache.h"
+
+#include "Config.h"
+#include "ConfigStreams.h"
+
+#define SNAPSHOT_FILE "data.bin"
+#define CONFIG_SNAPSHOT_FILE "config.bin"
+
+namespace {
+    using namespace QuickArmorRebalance;
+
+    constexpr std::uint32_t kSnapshotMagic = 0x53524151;  // "QARS"
+    constexpr std::uint32_t kSnapshotVersion = 1;
+
+    constexpr std::uint32_t kConfigSnapshotMagic = 0x43524151;  // "QARC"
+    constexpr std::uint32_t kConfigSnapshotVersion = 1;
+
+    std::filesystem::path GetSnapshotPath() {
+        return std::filesystem::current_path() / PATH_ROOT PATH_CACHE SNAPSHOT_FILE;
+    }
+
+    std::filesystem::path GetConfigSnapshotPath() {
+        return std::filesystem::current_path() / PATH_ROOT PATH_CACHE CONFIG_SNAPSHOT_FILE;
+    }
+
+    template <class T>
+    bool ReadForms(BinaryReader& r, std::set<T*>& forms) {
+        return QuickArmorRebalance::ReadForms(r, forms, [](RE::FormID id) { return RE::TESForm::LookupByID<T>(id); });
+    }
+
+    bool ReadContainers(BinaryReader& r, ContainerList& list) {
+        return QuickArmorRebalance::ReadContainers(r, list, [](RE::FormID id) { return RE::TESForm::LookupByID(id); });
+    }
+
+    void WriteRecipes(BinaryWriter& w, const RecipeIndex& index) {
+        w.Write((std::uint32_t)index.recipes.size());
+        for (const auto& i : index.recipes) {
+            w.Write(i.first->formID);
+            w.Write((std::uint32_t)i.second.size());
+            for (auto recipe : i.second) w.Write(recipe->formID);
+        }
+    }
+
+    using RecipeEntries = std::vector<std::pair<RE::TESBoundObject*, RE::BGSConstructibleObject*>>;
+
+    bool ReadRecipes(BinaryReader& r, RecipeEntries& entries) {
+        std::uint32_t nItems;
+        if (!r.Read(nItems)) return false;
+
+        for (std::uint32_t i = 0; i < nItems; i++) {
+            RE::FormID itemId;
+            std::uint32_t nRecipes;
+            if (!r.Read(itemId) || !r.Read(nRecipes)) return false;
+
+            auto item = RE::TESForm::LookupByID<RE::TESBoundObject>(itemId);
+            if (!item) return false;
+
+            for (std::uint32_t j = 0; j < nRecipes; j++) {
+                RE::FormID recipeId;
+                if (!r.Read(recipeId)) return false;
+
+                auto recipe = RE::TESForm::LookupByID<RE::BGSConstructibleObject>(recipeId);
+                if (!recipe || recipe->createdItem != item) return false;
+                entries.push_back({item, recipe});
+            }
+        }
+        return true;
+    }
+}
+
+std::uint64_t QuickArmorRebalance::GetLoadOrderFingerprint() {
+    auto dataHandler = RE::TESDataHandler::GetSingleton();
+    auto pathData = std::filesystem::current_path() / "Data";
+
+    auto hash = HashFNV(PLUGIN_NAME);
+
+    auto addFile = [&](const RE::TESFile* file) {
+        std::error_code ec;
+        auto path = pathData / file->GetFilename();
+        std::uint64_t size = std::filesystem::file_size(path, ec);
+        std::int64_t time = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+        bool blacklisted = g_Config.blacklist.contains(file);
+
+        hash = HashFNV(file->GetFilename(), hash);
+        hash = HashFNV({reinterpret_cast<const char*>(&size), sizeof(size)}, hash);
+        hash = HashFNV({reinterpret_cast<const char*>(&time), sizeof(time)}, hash);
+        hash = HashFNV({reinterpret_cast<const char*>(&blacklisted), sizeof(blacklisted)}, hash);
+    };
+
+    for (auto file : dataHandler->compiledFileCollection.files) addFile(file);
+    for (auto file : dataHandler->compiledFileCollection.smallFiles) addFile(file);
+
+    return hash;
+}
+
+bool QuickArmorRebalance::LoadDataSnapshot(std::uint64_t fingerprint) {
+    BinaryReader r;
+    if (!r.Load(GetSnapshotPath())) return false;
+
+    std::uint32_t magic, version;
+    std::uint64_t fileFingerprint;
+    if (!r.Read(magic) || !r.Read(version) || !r.Read(fileFingerprint)) return false;
+    if (magic != kSnapshotMagic || version != kSnapshotVersion) return false;
+    if (fileFingerprint != fingerprint) {
+        logger::debug("Load order changed, rebuilding data snapshot");
+        return false;
+    }
+
+    // Resolve everything before touching g_Data, so a stale snapshot falls back to a clean scan
+    std::vector<std::vector<RE::TESBoundObject*>> mods;
+    std::uint32_t nMods;
+    if (!r.Read(nMods)) return false;
+    mods.resize(nMods);
+
+    std::string modName;
+    for (auto& mod : mods) {
+        std::uint32_t nItems;
+        if (!r.ReadString(modName) || !r.Read(nItems) || !nItems) return false;
+
+        mod.reserve(nItems);
+        for (std::uint32_t i = 0; i < nItems; i++) {
+            RE::FormID id;
+            if (!r.Read(id)) return false;
+
+            auto item = RE::TESForm::LookupByID<RE::TESBoundObject>(id);
+            if (!item || item->GetFile(0)->GetFilename() != modName) return false;
+            mod.push_back(item);
+        }
+    }
+
+    RecipeEntries temper, craft;
+    if (!ReadRecipes(r, temper) || !ReadRecipes(r, craft) || !r.AtEnd()) return false;
+
+    for (const auto& mod : mods) {
+        for (auto i : mod) {
+            g_Data.itemStates.flags[g_Data.itemStates.Track(i)] |= ItemStates::kValid | ItemStates::kValidChecked;
+            AddModItem(i);
+        }
+    }
+
+    for (const auto& i : temper) g_Data.temperRecipes.Add(i.first, i.second);
+    for (const auto& i : craft) g_Data.craftRecipes.Add(i.first, i.second);
+
+    return true;
+}
+
+void QuickArmorRebalance::SaveDataSnapshot(std::uint64_t fingerprint) {
+    BinaryWriter w;
+    w.Write(kSnapshotMagic);
+    w.Write(kSnapshotVersion);
+    w.Write(fingerprint);
+
+    w.Write((std::uint32_t)g_Data.sortedMods.size());
+    for (auto mod : g_Data.sortedMods) {
+        w.WriteString(mod->mod->GetFilename());
+        w.Write((std::uint32_t)mod->items.size());
+        for (auto i : mod->items) w.Write(i->formID);
+    }
+
+    WriteRecipes(w, g_Data.temperRecipes);
+    WriteRecipes(w, g_Data.craftRecipes);
+
+    if (!w.Save(GetSnapshotPath())) logger::warn("Could not write data snapshot {}", GetSnapshotPath().generic_string());
+}
+
+bool QuickArmorRebalance::LoadConfigSnapshot(std::uint64_t key) {
+    BinaryReader r;
+    if (!r.Load(GetConfigSnapshotPath())) return false;
+
+    std::uint32_t magic, version;
+    std::uint64_t fileKey;
+    if (!r.Read(magic) || !r.Read(version) || !r.Read(fileKey)) return false;
+    if (magic != kConfigSnapshotMagic || version != kConfigSnapshotVersion) return false;
+    if (fileKey != key) {
+        logger::debug("Config or load order changed, rebuilding config snapshot");
+        return false;
+    }
+
+    // Everything is resolved into locals first, so a stale snapshot falls back to loading the config files cleanly
+    auto dataHandler = RE::TESDataHandler::GetSingleton();
+    std::uint32_t n;
+    std::string str;
+
+    std::set<const RE::TESFile*> blacklist;
+    if (!r.Read(n)) return false;
+    for (std::uint32_t i = 0; i < n; i++) {
+        if (!r.ReadString(str)) return false;
+
+        auto mod = dataHandler->LookupModByName(str);
+        if (!mod) return false;
+        blacklist.insert(mod);
+    }
+
+    std::set<RE::BGSKeyword*> kwSet, kwSlotSpecSet, kwSetWeap, kwSetWeapTypes;
+    unsigned int usedSlotsMask;
+    if (!ReadForms(r, kwSet) || !ReadForms(r, kwSlotSpecSet) || !ReadForms(r, kwSetWeap) ||
+        !ReadForms(r, kwSetWeapTypes) || !r.Read(usedSlotsMask))
+        return false;
+
+    std::vector<std::pair<std::string, RebalanceCurveNode::Tree>> curves;
+    if (!r.Read(n)) return false;
+    for (std::uint32_t i = 0; i < n; i++) {
+        auto& curve = curves.emplace_back();
+        if (!r.ReadString(curve.first) || !ReadCurve(r, curve.second)) return false;
+    }
+
+    std::map<std::string, LootDistGroup> distGroups;
+    if (!r.Read(n)) return false;
+    for (std::uint32_t i = 0; i < n; i++) {
+        if (!r.ReadString(str)) return false;
+
+        auto& group = distGroups[str];
+        if (!r.ReadString(group.name) || !r.Read(group.level) || !r.Read(group.early) || !r.Read(group.peak) ||
+            !r.Read(group.falloff) || !r.Read(group.minw) || !r.Read(group.maxw))
+            return false;
+    }
+
+    // Armor sets with the name of their dist group, if they have one
+    std::vector<std::pair<BaseArmorSet, std::optional<std::string>>> armorSets;
+    if (!r.Read(n)) return false;
+    for (std::uint32_t i = 0; i < n; i++) {
+        auto& [set, group] = armorSets.emplace_back();
+        bool hasLoot;
+        if (!r.ReadString(set.name) || !r.ReadString(set.strContents) || !r.Read(hasLoot)) return false;
+        if (hasLoot && !r.ReadString(group.emplace())) return false;
+        if (!ReadForms(r, set.items) || !ReadForms(r, set.weaps) || !ReadForms(r, set.ammo)) return false;
+    }
+
+    std::set<std::string> lootProfiles;
+    if (!r.Read(n)) return false;
+    for (std::uint32_t i = 0; i < n; i++) {
+        if (!r.ReadString(str)) return false;
+        lootProfiles.insert(str);
+    }
+
+    std::map<std::string, LootContainerGroup> containerGroups;
+    if (!r.Read(n)) return false;
+    for (std::uint32_t i = 0; i < n; i++) {
+        if (!r.ReadString(str)) return false;
+
+        auto& group = containerGroups[str];
+        if (!ReadContainers(r, group.large) || !ReadContainers(r, group.small) || !ReadContainers(r, group.weapon))
+            return false;
+    }
+
+    std::vector<std::pair<std::string, std::vector<std::string>>> distProfiles;  // Names of their container groups
+    if (!r.Read(n)) return false;
+    for (std::uint32_t i = 0; i < n; i++) {
+        auto& [name, groups] = distProfiles.emplace_back();
+        std::uint32_t nGroups;
+        if (!r.ReadString(name) || !r.Read(nGroups)) return false;
+
+        groups.resize(nGroups);
+        for (auto& j : groups) {
+            if (!r.ReadString(j)) return false;
+        }
+    }
+
+    if (!r.AtEnd()) return false;
+
+    g_Config.blacklist.insert(blacklist.begin(), blacklist.end());
+    g_Config.kwSet.insert(kwSet.begin(), kwSet.end());
+    g_Config.kwSlotSpecSet.insert(kwSlotSpecSet.begin(), kwSlotSpecSet.end());
+    g_Config.kwSetWeap.insert(kwSetWeap.begin(), kwSetWeap.end());
+    g_Config.kwSetWeapTypes.insert(kwSetWeapTypes.begin(), kwSetWeapTypes.end());
+    g_Config.usedSlotsMask |= usedSlotsMask;
+    auto& names = g_Data.names;
+    for (auto& [name, curve] : curves) g_Config.curves.push_back({names.Intern(name), std::move(curve)});
+
+    for (auto& [name, group] : distGroups) g_Data.distGroups[names.Intern(name)] = std::move(group);
+    for (auto& [set, group] : armorSets) {
+        set.id = names.Intern(set.name);
+        if (group) set.loot = &g_Data.distGroups[names.Intern(*group)];
+        g_Config.armorSets.push_back(std::move(set));
+    }
+
+    for (const auto& i : lootProfiles) {
+        auto id = names.Intern(i);
+        auto& profiles = g_Config.lootProfiles;
+        if (std::find(profiles.begin(), profiles.end(), id) == profiles.end()) profiles.push_back(id);
+    }
+    for (auto& [name, group] : containerGroups) g_Data.loot->containerGroups[names.Intern(name)] = std::move(group);
+    for (const auto& [name, groups] : distProfiles) {
+        auto& profile = g_Data.loot->distProfiles[names.Intern(name)];
+        for (const auto& i : groups) profile.containerGroups.insert(&g_Data.loot->containerGroups[names.Intern(i)]);
+    }
+
+    return true;
+}
+
+void QuickArmorRebalance::SaveConfigSnapshot(std::uint64_t key) {
+    BinaryWriter w;
+    w.Write(kConfigSnapshotMagic);
+    w.Write(kConfigSnapshotVersion);
+    w.Write(key);
+
+    w.Write((std::uint32_t)g_Config.blacklist.size());
+    for (auto mod : g_Config.blacklist) w.WriteString(mod->GetFilename());
+
+    WriteForms(w, g_Config.kwSet);
+    WriteForms(w, g_Config.kwSlotSpecSet);
+    WriteForms(w, g_Config.kwSetWeap);
+    WriteForms(w, g_Config.kwSetWeapTypes);
+    w.Write(g_Config.usedSlotsMask);
+
+    w.Write((std::uint32_t)g_Config.curves.size());
+    for (const auto& [name, curve] : g_Config.curves) {
+        w.WriteString(g_Data.names.GetName(name));
+        WriteCurve(w, curve);
+    }
+
+    // Groups are referenced by pointer, so they're written out by the name they're stored under
+    std::map<const LootDistGroup*, NameID> distGroupNames;
+    w.Write((std::uint32_t)g_Data.distGroups.size());
+    for (const auto& [name, group] : g_Data.distGroups) {
+        distGroupNames[&group] = name;
+        w.WriteString(g_Data.names.GetName(name));
+        w.WriteString(group.name);
+        w.Write(group.level);
+        w.Write(group.early);
+        w.Write(group.peak);
+        w.Write(group.falloff);
+        w.Write(group.minw);
+        w.Write(group.maxw);
+    }
+
+    w.Write((std::uint32_t)g_Config.armorSets.size());
+    for (const auto& i : g_Config.armorSets) {
+        w.WriteString(i.name);
+        w.WriteString(i.strContents);
+        w.Write(i.loot != nullptr);
+        if (i.loot) w.WriteString(g_Data.names.GetName(distGroupNames[i.loot]));
+        WriteForms(w, i.items);
+        WriteForms(w, i.weaps);
+        WriteForms(w, i.ammo);
+    }
+
+    w.Write((std::uint32_t)g_Config.lootProfiles.size());
+    for (auto i : g_Config.lootProfiles) w.WriteString(g_Data.names.GetName(i));
+
+    std::map<const LootContainerGroup*, NameID> containerGroupNames;
+    w.Write((std::uint32_t)g_Data.loot->containerGroups.size());
+    for (const auto& [name, group] : g_Data.loot->containerGroups) {
+        containerGroupNames[&group] = name;
+        w.WriteString(g_Data.names.GetName(name));
+        WriteContainers(w, group.large);
+        WriteContainers(w, group.small);
+        WriteContainers(w, group.weapon);
+    }
+
+    w.Write((std::uint32_t)g_Data.loot->distProfiles.size());
+    for (const auto& [name, profile] : g_Data.loot->distProfiles) {
+        w.WriteString(g_Data.names.GetName(name));
+        w.Write((std::uint32_t)profile.containerGroups.size());
+        for (auto i : profile.containerGroups) w.WriteString(g_Data.names.GetName(containerGroupNames[i]));
+    }
+
+    if (!w.Save(GetConfigSnapshotPath()))
+        logger::warn("Could not write config snapshot {}", GetConfigSnapshotPath().generic_string());
+}
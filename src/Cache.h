@@ -0,0 +1,17 @@
+#pragma once
+
+#include "BinaryIO.h"
+#include "Data.h"
+
+namespace QuickArmorRebalance {
+    // Changes whenever a plugin is added, removed, reordered, resized or touched, or the blacklist changes
+    std::uint64_t GetLoadOrderFingerprint();
+
+    bool LoadDataSnapshot(std::uint64_t fingerprint);
+    void SaveDataSnapshot(std::uint64_t fingerprint);
+
+    // The fully resolved config (keyword sets, curves, armor sets and loot groups), keyed on the config file hashes
+    // and the load order so it is only trusted when neither has changed
+    bool LoadConfigSnapshot(std::uint64_t key);
+    void SaveConfigSnapshot(std::uint64_t key);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string_view>
+
+#include "BinaryIO.h"
+
+// Change entries are decoded in ArmorChanger.cpp, but finding which field a member is doesn't need the game or
+// rapidjson, so it's tested on its own
+
+namespace QuickArmorRebalance {
+    // The members a change entry can have. An entry is decoded in one pass over its members, dispatching on the hash
+    // of each name rather than scanning the member list once per field
+    enum ChangeField {
+        kFieldSrcFile,
+        kFieldSrcId,
+        kFieldW,
+        kFieldArmor,
+        kFieldDamage,
+        kFieldWeight,
+        kFieldSpeed,
+        kFieldStagger,
+        kFieldValue,
+        kFieldKeywords,
+        kFieldSlots,
+        kFieldLoot,
+        kFieldTemper,
+        kFieldCraft,
+        kChangeFields,
+        kNoField = kChangeFields
+    };
+
+    constexpr std::string_view kChangeFieldNames[kChangeFields] = {
+        "srcfile", "srcid", "w", "armor", "damage", "weight", "speed",
+        "stagger", "value", "keywords", "slots", "loot", "temper", "craft"};
+
+    constexpr ChangeField FindChangeField(std::string_view name) {
+        ChangeField f;
+        switch (HashFNV(name)) {
+            case HashFNV("srcfile"): f = kFieldSrcFile; break;
+            case HashFNV("srcid"): f = kFieldSrcId; break;
+            case HashFNV("w"): f = kFieldW; break;
+            case HashFNV("armor"): f = kFieldArmor; break;
+            case HashFNV("damage"): f = kFieldDamage; break;
+            case HashFNV("weight"): f = kFieldWeight; break;
+            case HashFNV("speed"): f = kFieldSpeed; break;
+            case HashFNV("stagger"): f = kFieldStagger; break;
+            case HashFNV("value"): f = kFieldValue; break;
+            case HashFNV("keywords"): f = kFieldKeywords; break;
+            case HashFNV("slots"): f = kFieldSlots; break;
+            case HashFNV("loot"): f = kFieldLoot; break;
+            case HashFNV("temper"): f = kFieldTemper; break;
+            case HashFNV("craft"): f = kFieldCraft; break;
+            default: return kNoField;
+        }
+        return kChangeFieldNames[f] == name ? f : kNoField;  // Another name can share a hash
+    }
+
+    constexpr bool IsChangeFieldTableValid() {
+        for (int i = 0; i < kChangeFields; i++) {
+            if (FindChangeField(kChangeFieldNames[i]) != i) return false;
+        }
+        return true;
+    }
+    static_assert(IsChangeFieldTableValid(), "Change field names and their hash dispatch don't match");
+}
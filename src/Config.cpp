@@ -1,8 +1,13 @@
 #include "Config.h"
 
 #include <filesystem>
+#include <future>
 
+#include "Cache.h"
 #include "Data.h"
+#include "JsonArena.h"
+#include "Parallel.h"
+#include "Resolver.h"
 #include "rapidjson/document.h"
 #include "rapidjson/error/en.h"
 #include "rapidjson/error/error.h"
@@ -23,37 +28,23 @@ namespace QuickArmorRebalance {
     Config g_Config;
 
     RebalanceCurveNode::Tree LoadCurveNode(const Value& node);
-    bool LoadArmorSet(BaseArmorSet& s, const Value& node);
-
-    RE::TESObjectWEAP* BaseArmorSet::FindMatching(RE::TESObjectWEAP* w) const
-    { 
-        for (auto i : weaps) {
-            if (i->GetWeaponType() == w->GetWeaponType())
-            {
-                //2h maces use the same weapon type as 2h axe, so need to actually compare keywords
-                for (unsigned int j = 0; j<i->numKeywords; j++)
-                {
-                    if (g_Config.kwSetWeapTypes.contains(i->keywords[j])) {
-                        if (w->HasKeyword(i->keywords[j])) return i;
-                        break;
-                    }
-                }
+    bool LoadArmorSet(BaseArmorSet& s, const Value& node, NameResolver& resolver);
 
-            }
-        }
-        return nullptr; 
+    namespace {
+        bool IsWeaponTypeKeyword(RE::BGSKeyword* kw) { return g_Config.kwSetWeapTypes.contains(kw); }
+
+        bool IsBolt(const RE::TESAmmo* a) { return a->GetRuntimeData().data.flags.none(RE::AMMO_DATA::Flag::kNonBolt); }
     }
 
-    RE::TESAmmo* BaseArmorSet::FindMatching(RE::TESAmmo* w) const {
-        for (auto i : ammo) {
-            if (i->GetRuntimeData().data.flags.none(RE::AMMO_DATA::Flag::kNonBolt) ==
-                w->GetRuntimeData().data.flags.none(RE::AMMO_DATA::Flag::kNonBolt)) {
-                return i;
-            }
-        }
-        return nullptr;
+    void BaseArmorSet::BuildMatchIndex() { match.Build(weaps, ammo, IsWeaponTypeKeyword, IsBolt); }
+
+    RE::TESObjectWEAP* BaseArmorSet::FindMatching(RE::TESObjectWEAP* w) const {
+        return match.bBuilt ? match.Find(w) : FindMatchingWeapon(weaps, w, IsWeaponTypeKeyword);
     }
 
+    RE::TESAmmo* BaseArmorSet::FindMatching(RE::TESAmmo* w) const {
+        return match.bBuilt ? match.Find(w, IsBolt) : FindMatchingAmmo(ammo, w, IsBolt);
+    }
 }
 
 void LoadPermissions(QuickArmorRebalance::Permissions& p, toml::node_view<toml::node> tbl) {
@@ -75,27 +66,135 @@ void LoadPermissions(QuickArmorRebalance::Permissions& p, toml::node_view<toml::
     p.temper.bFree = tbl["freeTemper"].value_or(true);
 }
 
-bool QuickArmorRebalance::Config::Load() {
-    bool bSuccess = false;
-    auto pathConfig = std::filesystem::current_path() / PATH_ROOT PATH_CONFIGS;
+namespace {
+    // A config file as read off disk, nothing in it has been looked up in the game data yet
+    struct ParsedConfig {
+        std::filesystem::path path;
+        std::unique_ptr<ArenaDocument> doc;
+        std::string error;
+    };
 
-    if (!std::filesystem::exists(pathConfig) || !std::filesystem::is_directory(pathConfig)) {
-        logger::error("Config file directory missing ({})", pathConfig.generic_string());
-        return false;
+    ParsedConfig ParseConfigFile(std::filesystem::path path) {
+        ParsedConfig r{std::move(path)};
+
+        auto fp = std::fopen(r.path.generic_string().c_str(), "rb");
+        if (!fp) {
+            r.error = "Could not open config file";
+            return r;
+        }
+
+        char readBuffer[1 << 16];
+        FileReadStream is(fp, readBuffer, sizeof(readBuffer));
+
+        auto d = std::make_unique<ArenaDocument>();
+        d->ParseStream(is);
+        std::fclose(fp);
+
+        if (d->HasParseError()) {
+            r.error =
+                std::format("JSON parse error: {} ({})", GetParseError_En(d->GetParseError()), d->GetErrorOffset());
+            return r;
+        }
+
+        if (!d->IsObject()) {
+            r.error = "root is not object";
+            return r;
+        }
+
+        r.doc = std::move(d);
+        return r;
     }
+}
 
+bool QuickArmorRebalance::Config::LoadConfigFiles(const std::filesystem::path& pathConfig) {
+    std::vector<std::filesystem::path> paths;
     for (const auto& entry : std::filesystem::directory_iterator(pathConfig)) {
         if (!entry.is_regular_file()) continue;
         if (_stricmp(entry.path().extension().generic_string().c_str(), ".json")) continue;
+        paths.push_back(entry.path());
+    }
+
+    // Files are read and parsed by a worker per core, taking them in directory order. Looking names up in the game
+    // data isn't thread safe and later files add to what earlier ones loaded, so that part stays serial and in order
+    // here, each file resolved as soon as it's parsed
+    bool bSuccess = false;
+    auto timeStart = std::chrono::steady_clock::now();
+
+    std::vector<std::promise<ParsedConfig>> results(paths.size());
+    std::vector<std::future<ParsedConfig>> parsing;
+    parsing.reserve(paths.size());
+    for (auto& i : results) parsing.push_back(i.get_future());
+
+    auto workers = std::async(std::launch::async, [&]() {
+        ParallelFor(paths.size(), [&](std::size_t n) { results[n].set_value(ParseConfigFile(paths[n])); });
+    });
+
+    NameResolver resolver;
+    std::chrono::duration<float, std::milli> msWaiting{}, msResolving{};
+    for (auto& i : parsing) {
+        auto timeWait = std::chrono::steady_clock::now();
+        auto parsed = i.get();
+        auto timeResolve = std::chrono::steady_clock::now();
+        msWaiting += timeResolve - timeWait;
 
-        logger::debug("Loading config file {}", entry.path().filename().generic_string());
-        if (LoadFile(entry.path())) {
+        auto filename = parsed.path.filename().generic_string();
+        logger::debug("Loading config file {}", filename);
+        if (!parsed.doc) logger::warn("{}: {}", filename, parsed.error);
+
+        if (parsed.doc && LoadDocument(parsed.path, *parsed.doc, resolver)) {
             bSuccess = true;
         } else {
-            logger::warn("Failed to load config file {}", entry.path().filename().generic_string());
+            logger::warn("Failed to load config file {}", filename);
         }
+        msResolving += std::chrono::steady_clock::now() - timeResolve;
+    }
+    workers.get();
+
+    logger::info("Loaded {} config files in {:.1f}ms ({:.1f}ms resolving, {:.1f}ms waiting on parsing)", paths.size(),
+                 std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - timeStart).count(),
+                 msResolving.count(), msWaiting.count());
+    resolver.LogStats();
+
+    return bSuccess;
+}
+
+bool QuickArmorRebalance::Config::Load() {
+    bool bSuccess = false;
+    auto pathConfig = std::filesystem::current_path() / PATH_ROOT PATH_CONFIGS;
+
+    if (!std::filesystem::exists(pathConfig) || !std::filesystem::is_directory(pathConfig)) {
+        logger::error("Config file directory missing ({})", pathConfig.generic_string());
+        return false;
+    }
+
+    // A warm start loads the already resolved config instead, as long as neither the config files nor the load
+    // order have changed since it was written
+    configHash = HashConfigFiles();
+    auto snapshotKey = HashFNV({reinterpret_cast<const char*>(&configHash), sizeof(configHash)},
+                               GetLoadOrderFingerprint());
+
+    // Read ahead of the config files, the chunk size has to be set before any of them are parsed
+    auto settingsFile = toml::parse_file((std::filesystem::current_path() / PATH_ROOT SETTINGS_FILE).generic_string());
+    if (settingsFile) {
+        g_Config.jsonChunkKB = std::clamp(settingsFile["settings"]["jsonchunksize"].value_or(64), 4, 4096);
+        SetJsonChunkSize((std::size_t)g_Config.jsonChunkKB << 10);
     }
 
+    auto timeStart = std::chrono::steady_clock::now();
+    if (LoadConfigSnapshot(snapshotKey)) {
+        bSuccess = true;
+        logger::info("Loaded config snapshot in {:.1f}ms",
+                     std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - timeStart).count());
+    } else {
+        bSuccess = LoadConfigFiles(pathConfig);
+        if (bSuccess) SaveConfigSnapshot(snapshotKey);
+    }
+
+    for (auto& i : armorSets) i.BuildMatchIndex();
+    std::sort(lootProfiles.begin(), lootProfiles.end(), [](NameID a, NameID b) {
+        return _stricmp(g_Data.names.GetName(a).c_str(), g_Data.names.GetName(b).c_str()) < 0;
+    });
+
     if (!bSuccess) {
         logger::error("Failed to read any config files");
     } else {
@@ -109,7 +208,7 @@ bool QuickArmorRebalance::Config::Load() {
     {
         const char* lootProfile = "Treasure - Universal";
 
-        auto config = toml::parse_file((std::filesystem::current_path() / PATH_ROOT SETTINGS_FILE).generic_string());
+        auto& config = settingsFile;
         if (config) {
             g_Config.acParams.bMerge = config["merge"].value_or(true);
             g_Config.acParams.bModifyKeywords = config["modifyKeywords"].value_or(true);
@@ -125,23 +224,9 @@ bool QuickArmorRebalance::Config::Load() {
             g_Config.acParams.value.bModify= config["modifyValue"].value_or(true);
 
             auto armorSet = config["armorset"];
-            if (armorSet.is_string()) {
-                auto str = armorSet.value<std::string>();
-                for (auto& i : g_Config.armorSets) {
-                    if (!_stricmp(str->c_str(), i.name.c_str())) {
-                        g_Config.acParams.armorSet = &i;
-                        break;
-                    }
-                }
-            }
+            if (armorSet.is_string()) g_Config.acParams.armorSet = FindArmorSet(*armorSet.value<std::string>());
 
-            auto curve = config["curve"].value_or("QAR");
-            for (auto& i : g_Config.curves) {
-                if (!_stricmp(curve, i.first.c_str())) {
-                    g_Config.acParams.curve = &i.second;
-                    break;
-                }
-            }
+            g_Config.acParams.curve = FindCurve(config["curve"].value_or("QAR"));
 
             lootProfile = config["loot"]["profile"].value_or("Treasure - Universal");
             g_Config.acParams.bDistribute = config["loot"]["enable"].value_or(false);
@@ -183,10 +268,11 @@ bool QuickArmorRebalance::Config::Load() {
 
         if (!g_Config.acParams.armorSet) g_Config.acParams.armorSet = &g_Config.armorSets[0];
         if (!g_Config.acParams.curve) g_Config.acParams.curve = &g_Config.curves[0].second;
-        if (g_Config.lootProfiles.contains(lootProfile))
-            g_Config.acParams.distProfile = g_Config.lootProfiles.find(lootProfile)->c_str();
+        auto profile = g_Data.names.Find(lootProfile);
+        if (std::find(lootProfiles.begin(), lootProfiles.end(), profile) != lootProfiles.end())
+            g_Config.acParams.distProfile = profile;
         else if (!lootProfiles.empty())
-            g_Config.acParams.distProfile = lootProfiles.begin()->c_str();
+            g_Config.acParams.distProfile = lootProfiles.front();
 
     }
 
@@ -199,23 +285,106 @@ bool QuickArmorRebalance::Config::Load() {
     return bSuccess;
 }
 
+std::uint64_t QuickArmorRebalance::Config::HashConfigFiles() {
+    auto pathConfig = std::filesystem::current_path() / PATH_ROOT PATH_CONFIGS;
+
+    std::error_code ec;
+    std::vector<std::filesystem::path> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(pathConfig, ec)) {
+        if (!entry.is_regular_file()) continue;
+        if (_stricmp(entry.path().extension().generic_string().c_str(), ".json")) continue;
+        paths.push_back(entry.path());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    auto hash = HashFNV(PATH_CONFIGS);
+    for (const auto& i : paths) {
+        auto fileHash = HashFile(i);
+        hash = HashFNV(i.filename().generic_string(), hash);
+        hash = HashFNV({reinterpret_cast<const char*>(&fileHash), sizeof(fileHash)}, hash);
+    }
+    return hash;
+}
+
+QuickArmorRebalance::BaseArmorSet* QuickArmorRebalance::Config::FindArmorSet(std::string_view name) {
+    auto id = g_Data.names.Find(name);
+    if (id == kNoName) return nullptr;
+
+    for (auto& i : armorSets) {
+        if (i.id == id) return &i;
+    }
+    return nullptr;
+}
+
+QuickArmorRebalance::RebalanceCurveNode::Tree* QuickArmorRebalance::Config::FindCurve(std::string_view name) {
+    auto id = g_Data.names.Find(name);
+    if (id == kNoName) return nullptr;
+
+    for (auto& i : curves) {
+        if (i.first == id) return &i.second;
+    }
+    return nullptr;
+}
+
+bool QuickArmorRebalance::Config::Reload() {
+    // Selections are held by pointer into the containers about to be rebuilt, so go by name instead
+    NameID armorSetName = acParams.armorSet ? acParams.armorSet->id : kNoName;
+    NameID curveName = kNoName;
+    for (const auto& i : curves) {
+        if (&i.second == acParams.curve) curveName = i.first;
+    }
+    NameID profileName = acParams.distProfile;
+
+    blacklist.clear();
+    kwSet.clear();
+    kwSlotSpecSet.clear();
+    kwSetWeap.clear();
+    kwSetWeapTypes.clear();
+    curves.clear();
+    armorSets.clear();
+    lootProfiles.clear();
+    usedSlotsMask = 0;
+
+    acParams.armorSet = nullptr;
+    acParams.curve = nullptr;
+    acParams.distProfile = kNoName;
+
+    // Loot lists are only built at startup, the loot config is parsed into throwaway data so everything else that
+    // refers to it still resolves
+    g_Data.distGroups.clear();
+    g_Data.loot = std::make_unique<ModLootData>();
+    bool bSuccess = Load();
+    g_Data.loot.reset();
+
+    for (auto& i : armorSets) {
+        if (i.id == armorSetName) acParams.armorSet = &i;
+    }
+    for (auto& i : curves) {
+        if (i.first == curveName) acParams.curve = &i.second;
+    }
+    if (std::find(lootProfiles.begin(), lootProfiles.end(), profileName) != lootProfiles.end())
+        acParams.distProfile = profileName;
+
+    InvalidateValidItems();
+    return bSuccess;
+}
+
 namespace {
     void ConfigFileWarning(std::filesystem::path path, const char* str) {
         logger::warn("{}: {}", path.filename().generic_string(), str);
     }
 
-    bool LoadKeywords(std::filesystem::path path, const Value& d, const char* field, std::set<RE::BGSKeyword*>& set) {
+    bool LoadKeywords(std::filesystem::path path, const Value& d, const char* field, std::set<RE::BGSKeyword*>& set,
+                      NameResolver& resolver) {
         const auto& jsonKeywords = d[field];
         if (jsonKeywords.IsArray()) {
+            std::vector<std::string_view> names;
+            names.reserve(jsonKeywords.Size());
             for (const auto& i : jsonKeywords.GetArray()) {
-                if (i.IsString()) {
-                    auto kw = RE::TESForm::LookupByEditorID<RE::BGSKeyword>(i.GetString());
-                    if (kw) {
-                        set.insert(kw);
-                    } else
-                        logger::info("Keyword not found: {}", i.GetString());
-                }
+                if (i.IsString()) names.emplace_back(i.GetString(), i.GetStringLength());
             }
+
+            for (auto kw : resolver.FindAll<RE::BGSKeyword>(names, "Keyword")) set.insert(kw);
             return true;
         } else
             ConfigFileWarning(path, std::format("{} expected to be an array", field).c_str());
@@ -225,38 +394,24 @@ namespace {
 }
 
 bool QuickArmorRebalance::Config::LoadFile(std::filesystem::path path) {
-    auto dataHandler = RE::TESDataHandler::GetSingleton();
-
-    auto fp = std::fopen(path.generic_string().c_str(), "rb");
-
-    if (!fp) {
-        logger::warn("Could not open config file {}", path.filename().generic_string());
+    auto parsed = ParseConfigFile(std::move(path));
+    if (!parsed.doc) {
+        logger::warn("{}: {}", parsed.path.filename().generic_string(), parsed.error);
         return false;
     }
 
-    char readBuffer[1 << 16];
-    FileReadStream is(fp, readBuffer, sizeof(readBuffer));
-
-    Document d;
-    d.ParseStream(is);
-    std::fclose(fp);
-
-    if (d.HasParseError()) {
-        logger::warn("JSON parse error: {} ({})", GetParseError_En(d.GetParseError()), d.GetErrorOffset());
-        return false;
-    }
-
-    if (!d.IsObject()) {
-        logger::warn("root is not object");
-        return false;
-    }
+    NameResolver resolver;
+    return LoadDocument(parsed.path, *parsed.doc, resolver);
+}
 
+bool QuickArmorRebalance::Config::LoadDocument(const std::filesystem::path& path, const Value& d,
+                                               NameResolver& resolver) {
     if (d.HasMember("blacklist")) {
         const auto& jsonblacklist = d["blacklist"];
         if (jsonblacklist.IsArray()) {
             for (const auto& i : jsonblacklist.GetArray()) {
                 if (i.IsString()) {
-                    auto mod = dataHandler->LookupModByName(i.GetString());
+                    auto mod = resolver.FindMod(i.GetString());
                     if (mod) {
                         logger::debug("Blacklisting {}", mod->fileName);
                         this->blacklist.insert(mod);
@@ -270,7 +425,7 @@ bool QuickArmorRebalance::Config::LoadFile(std::filesystem::path path) {
     if (d.HasMember("requires")) {
         const auto& jsonRequires = d["requires"];
         if (jsonRequires.IsString()) {
-            if (!dataHandler->LookupModByName(jsonRequires.GetString())) {
+            if (!resolver.FindMod(jsonRequires.GetString())) {
                 logger::debug("{}: Lacking required mod \"{}\", skipping",
                               path.filename().generic_string(), jsonRequires.GetString());
                 return true;
@@ -279,19 +434,19 @@ bool QuickArmorRebalance::Config::LoadFile(std::filesystem::path path) {
     }
 
     if (d.HasMember("keywords")) {
-        LoadKeywords(path, d, "keywords", kwSet);
+        LoadKeywords(path, d, "keywords", kwSet, resolver);
     }
 
     if (d.HasMember("keywordsSlotSpecific")) {
-        LoadKeywords(path, d, "keywordsSlotSpecific", kwSlotSpecSet);
+        LoadKeywords(path, d, "keywordsSlotSpecific", kwSlotSpecSet, resolver);
     }
 
     if (d.HasMember("keywordsWeapon")) {
-        LoadKeywords(path, d, "keywordsWeapon", kwSetWeap);
+        LoadKeywords(path, d, "keywordsWeapon", kwSetWeap, resolver);
     }
 
     if (d.HasMember("keywordsWeaponTypes")) {
-        LoadKeywords(path, d, "keywordsWeaponTypes", kwSetWeapTypes);
+        LoadKeywords(path, d, "keywordsWeaponTypes", kwSetWeapTypes, resolver);
     }
 
     if (d.HasMember("curves")) {
@@ -300,7 +455,7 @@ bool QuickArmorRebalance::Config::LoadFile(std::filesystem::path path) {
         if (jsonCurves.IsObject()) {
             for (const auto& i : jsonCurves.GetObj()) {
                 auto curve{LoadCurveNode(i.value)};
-                if (!curve.empty()) curves.push_back({i.name.GetString(), std::move(curve)});
+                if (!curve.empty()) curves.push_back({g_Data.names.Intern(i.name.GetString()), std::move(curve)});
             }
         } else
             ConfigFileWarning(path, "curves expected to be an object");
@@ -311,10 +466,11 @@ bool QuickArmorRebalance::Config::LoadFile(std::filesystem::path path) {
         if (jsonSets.IsObject()) {
             for (const auto& i : jsonSets.GetObj()) {
                 BaseArmorSet s;
-                if (LoadArmorSet(s, i.value)) {
+                if (LoadArmorSet(s, i.value, resolver)) {
                     if (!(s.items.empty() && s.weaps.empty() && s.ammo.empty()) &&
                         s.loot) {  // Didn't load correctly, but not a critical failure (probably mod missing)
                         s.name = i.name.GetString();
+                        s.id = g_Data.names.Intern(s.name);
                         armorSets.push_back(std::move(s));
                     }
                 } else
@@ -326,7 +482,7 @@ bool QuickArmorRebalance::Config::LoadFile(std::filesystem::path path) {
     }
 
     if (d.HasMember("loot")) {
-        LoadLootConfig(d["loot"]);
+        LoadLootConfig(d["loot"], resolver);
     }
 
     return true;
@@ -363,31 +519,29 @@ QuickArmorRebalance::RebalanceCurveNode::Tree QuickArmorRebalance::LoadCurveNode
     return v;
 }
 
-bool QuickArmorRebalance::LoadArmorSet(BaseArmorSet& s, const Value& node) {
-    auto dataHandler = RE::TESDataHandler::GetSingleton();
-
+bool QuickArmorRebalance::LoadArmorSet(BaseArmorSet& s, const Value& node, NameResolver& resolver) {
     BaseArmorSet as;
     bool bSuccess = true;
 
     if (node.IsObject()) {
         if (node.HasMember("loot")) {
-            as.loot = &g_Data.distGroups[node["loot"].GetString()];
+            as.loot = &g_Data.distGroups[g_Data.names.Intern(node["loot"].GetString())];
         } else {
             logger::error("Item set missing 'loot' data");
             return false;
         }
 
         if (node.HasMember("file")) {
-            if (auto mod = dataHandler->LookupModByName(node["file"].GetString())) {
+            if (auto mod = resolver.FindMod(node["file"].GetString())) {
                 if (node.HasMember("items") && node["items"].IsArray()) {
                     unsigned int covered = 0;
                     for (const auto& i : node["items"].GetArray()) {
                         if (i.IsString()) {
                             auto str = i.GetString();
                             bool bOther;
-                            auto item = FindIn(mod, str, &bOther);
+                            auto item = resolver.FindIn(mod, str, &bOther);
                             if (!item) {
-                                if (!bOther)
+                                if (!bOther && resolver.IsFirstMiss("Set item", str))
                                     logger::error("Item not found for set {}", str);
                                 continue;
                             }
@@ -502,7 +656,7 @@ void QuickArmorRebalance::Config::Save() {
         {"modifyWeapStagger", g_Config.acParams.weapon.stagger.bModify},
         {"modifyValue", g_Config.acParams.value.bModify},
         {"armorset", g_Config.acParams.armorSet ? g_Config.acParams.armorSet->name : "error"},
-        {"curve", iCurve->first},
+        {"curve", g_Data.names.GetName(iCurve->first)},
         {"temper", toml::table{{"modify", g_Config.acParams.temper.bModify},
                                {"new", g_Config.acParams.temper.bNew},
                                {"free", g_Config.acParams.temper.bFree}}},
@@ -513,7 +667,9 @@ void QuickArmorRebalance::Config::Save() {
                              {"pieces", g_Config.acParams.bDistAsPieces},
                              {"sets", g_Config.acParams.bDistAsSet},
                              {"matching", g_Config.acParams.bMatchSetPieces},
-                             {"profile", g_Config.acParams.distProfile ? g_Config.acParams.distProfile : "error"}}},
+                             {"profile", g_Config.acParams.distProfile != kNoName
+                                             ? g_Data.names.GetName(g_Config.acParams.distProfile)
+                                             : "error"}}},
         {"settings",
          toml::table{
              {"verbosity", g_Config.verbosity},
@@ -532,6 +688,7 @@ void QuickArmorRebalance::Config::Save() {
              {"resetslotremap", g_Config.bResetSlotRemap},
              {"enableallitems", g_Config.bEnableAllItems},
              {"allowinvalidremap", g_Config.bAllowInvalidRemap},
+             {"jsonchunksize", g_Config.jsonChunkKB},
          }},
         {"localPermissions", SavePermissions(g_Config.permLocal)},
         {"sharedPermissions", SavePermissions(g_Config.permShared)},
@@ -547,7 +704,7 @@ void QuickArmorRebalance::Config::AddUserBlacklist(RE::TESFile* mod) {
 
     auto path = std::filesystem::current_path() / PATH_ROOT PATH_CONFIGS USER_BLACKLIST_FILE;
 
-    Document d;
+    ArenaDocument d;
 
     if (auto fp = std::fopen(path.generic_string().c_str(), "rb")) {
         char readBuffer[1 << 16];
@@ -599,11 +756,13 @@ void QuickArmorRebalance::Config::AddUserBlacklist(RE::TESFile* mod) {
     }
 
     g_Config.blacklist.insert(mod);
+    InvalidateValidItems(mod);
 
     for (auto i = g_Data.sortedMods.begin(); i != g_Data.sortedMods.end(); i++)
     {
         if ((*i)->mod == mod) {
             g_Data.sortedMods.erase(i);
+            g_Data.nextToPopulate = 0;
             break;
         }
     }
@@ -1,14 +1,19 @@
 #pragma once
 
 #include "Data.h"
+#include "WeaponMatch.h"
+
+#include <rapidjson/fwd.h>
 
 #define PATH_ROOT "Data/SKSE/Plugins/" PLUGIN_NAME "/"
 #define PATH_CONFIGS "config/"
 #define PATH_CHANGES "changes/"
+#define PATH_CACHE "cache/"
 
 namespace QuickArmorRebalance {
 
     struct LootDistGroup;
+    class NameResolver;
 
     const unsigned int kCosmeticSlotMask = 0;
     //(unsigned int)RE::BIPED_MODEL::BipedObjectSlot::kHead | (unsigned int)RE::BIPED_MODEL::BipedObjectSlot::kHair;
@@ -28,6 +33,7 @@ namespace QuickArmorRebalance {
     };
 
     struct BaseArmorSet {
+        NameID id = kNoName;
         std::string name;
         std::string strContents;
         LootDistGroup* loot = nullptr;
@@ -37,11 +43,19 @@ namespace QuickArmorRebalance {
 
         RE::TESObjectWEAP* FindMatching(RE::TESObjectWEAP* w) const;
         RE::TESAmmo* FindMatching(RE::TESAmmo* w) const;
+
+        // Indexes the set's weapons by type and type keyword once the config is fully loaded. Until then (while the
+        // set is still being built) FindMatching scans the set instead
+        void BuildMatchIndex();
+
+        BasicMatchIndex<RE::TESObjectWEAP, RE::TESAmmo> match;
     };
 
     struct ArmorChangeParams {
         std::vector<RE::TESBoundObject*> filteredItems;
+        std::vector<ItemStates::Ordinal> filteredOrdinals;  // One per filtered item
         std::vector<RE::TESBoundObject*> items;
+        std::vector<ArmorSlots> itemSlots;  // Original slots of each item, 0 for weapons and ammo
 
         BaseArmorSet* armorSet = nullptr;
         RebalanceCurveNode::Tree* curve = nullptr;
@@ -78,7 +92,7 @@ namespace QuickArmorRebalance {
         RecipeOptions temper;
         RecipeOptions craft;
 
-        const char* distProfile = nullptr;
+        NameID distProfile = kNoName;
         int rarity = 0;
         bool bDistribute = false;
         bool bDistAsSet = true;
@@ -118,7 +132,17 @@ namespace QuickArmorRebalance {
 
     struct Config {
         bool Load();
+        // Parses and resolves every config file in the directory
+        bool LoadConfigFiles(const std::filesystem::path& pathConfig);
         bool LoadFile(std::filesystem::path path);
+        // Resolves an already parsed config file against the loaded game data
+        bool LoadDocument(const std::filesystem::path& path, const rapidjson::Value& d, NameResolver& resolver);
+
+        // Re-reads every config file in place, keeping the current UI selections where they still exist
+        bool Reload();
+
+        // Combined content hash of the config files, to tell when they've changed since being loaded
+        static std::uint64_t HashConfigFiles();
 
         void Save();
 
@@ -131,9 +155,13 @@ namespace QuickArmorRebalance {
         std::set<RE::BGSKeyword*> kwSetWeap;
         std::set<RE::BGSKeyword*> kwSetWeapTypes;
 
-        std::vector<std::pair<std::string, RebalanceCurveNode::Tree>> curves;
+        // Look up by name ignoring case, nullptr if there isn't one
+        BaseArmorSet* FindArmorSet(std::string_view name);
+        RebalanceCurveNode::Tree* FindCurve(std::string_view name);
+
+        std::vector<std::pair<NameID, RebalanceCurveNode::Tree>> curves;
         std::vector<BaseArmorSet> armorSets;
-        std::set<std::string> lootProfiles;
+        std::vector<NameID> lootProfiles;  // Sorted by name
 
         unsigned int usedSlotsMask = 0;
         ArmorChangeParams acParams;
@@ -157,11 +185,14 @@ namespace QuickArmorRebalance {
         int verbosity = spdlog::level::info;
         int levelGranularity = 3;
         int craftingRarityMax = 2;
+        int jsonChunkKB = 64;  // Chunk size for the memory pools of json documents
 
         Permissions permLocal;
         Permissions permShared;
 
         ArmorSlots slotsWillChange = 0;
+
+        std::uint64_t configHash = 0;
     };
 
     extern Config g_Config;
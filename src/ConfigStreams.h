@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+
+#include "BinaryIO.h"
+#include "LootPlan.h"
+
+// The parts of the config snapshot that are written the same way wherever they come from. Forms are written by id and
+// looked up again through the function the caller passes, so none of this needs the game and it's tested on its own
+
+namespace QuickArmorRebalance {
+    constexpr int kMaxCurveDepth = 32;  // There are only 32 slots to nest
+
+    // Curve nodes only need a slot, a weight and their children
+    template <class Tree>
+    void WriteCurve(BinaryWriter& w, const Tree& tree) {
+        w.Write((std::uint32_t)tree.size());
+        for (const auto& i : tree) {
+            w.Write(i.slot);
+            w.Write(i.weight);
+            WriteCurve(w, i.children);
+        }
+    }
+
+    template <class Tree>
+    bool ReadCurve(BinaryReader& r, Tree& tree, int depth = 0) {
+        std::uint32_t n;
+        if (!r.Read(n) || n > kMaxCurveDepth || depth > kMaxCurveDepth) return false;
+
+        tree.resize(n);
+        for (auto& i : tree) {
+            if (!r.Read(i.slot) || !r.Read(i.weight) || !ReadCurve(r, i.children, depth + 1)) return false;
+        }
+        return true;
+    }
+
+    template <class T>
+    void WriteForms(BinaryWriter& w, const std::set<T*>& forms) {
+        w.Write((std::uint32_t)forms.size());
+        for (auto i : forms) w.Write(i->formID);
+    }
+
+    // Fails on the first id that lookup can't find, the snapshot is stale then
+    template <class T>
+    bool ReadForms(BinaryReader& r, std::set<T*>& forms, const auto& lookup) {
+        std::uint32_t n;
+        if (!r.Read(n)) return false;
+
+        for (std::uint32_t i = 0; i < n; i++) {
+            std::uint32_t id;
+            if (!r.Read(id)) return false;
+
+            T* form = lookup(id);
+            if (!form) return false;
+            forms.insert(form);
+        }
+        return true;
+    }
+
+    // A ContainerList, or anything else keyed on forms with a ContainerChance each
+    template <class List>
+    void WriteContainers(BinaryWriter& w, const List& list) {
+        w.Write((std::uint32_t)list.size());
+        for (const auto& [form, chance] : list) {
+            w.Write(form->formID);
+            w.Write(chance);
+        }
+    }
+
+    bool ReadContainers(BinaryReader& r, ContainerList& list, const auto& lookup) {
+        std::uint32_t n;
+        if (!r.Read(n)) return false;
+
+        for (std::uint32_t i = 0; i < n; i++) {
+            std::uint32_t id;
+            ContainerChance chance;
+            if (!r.Read(id) || !r.Read(chance)) return false;
+
+            RE::TESForm* form = lookup(id);
+            if (!form) return false;
+            list[form] = chance;
+        }
+        return true;
+    }
+}
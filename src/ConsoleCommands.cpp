@@ -1,5 +1,7 @@
 #include "ConsoleCommands.h"
 #include "Config.h"
+#include "Data.h"
+#include "Tasks.h"
 
 #include "ImGuiIntegration.h"
 
@@ -28,6 +30,19 @@ void CompileAndRun(RE::Script* a_script, RE::ScriptCompiler* a_compiler, RE::COM
 
     // Only one command atm, so lazy check
     if (!_stricmp(tokens[0].c_str(), "qar")) {
+        if (tokens.size() > 1 && !_stricmp(tokens[1].c_str(), "reload")) {
+            auto console = RE::ConsoleLog::GetSingleton();
+            if (IsTaskRunning()) {
+                console->Print("QAR: Can't reload while changes are being applied");
+                return;
+            }
+
+            auto stats = ReloadChangedFiles();
+            console->Print("QAR: Reloaded %d changed files%s in %.1fms, %d forms touched", stats.nFilesChanged,
+                           stats.bConfigChanged ? " and config" : "", stats.ms, stats.nFormsTouched);
+            return;
+        }
+
         ImGuiIntegration::Show(true);  
 
         if (g_Config.bCloseConsole) {
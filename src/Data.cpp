@@ -1,53 +1,563 @@
 #include "Data.h"
 
+#include <condition_variable>
+#include <future>
+
 #include "ArmorChanger.h"
+#include "Cache.h"
 #include "Config.h"
+#include "JsonArena.h"
+#include "ModGroups.h"
+#include "Parallel.h"
 #include "rapidjson/document.h"
 #include "rapidjson/error/en.h"
 #include "rapidjson/error/error.h"
-#include "rapidjson/filereadstream.h"
+#include "rapidjson/reader.h"
 #include "rapidjson/stringbuffer.h"
 
 using namespace rapidjson;
 
 namespace QuickArmorRebalance {
-    void LoadChangesFromFolder(const char* sub, const Permissions& perm);
-    bool LoadFileChanges(const RE::TESFile* mod, std::filesystem::path path, const Permissions& perm);
+    // Change files for one mod, from each of the layers
+    struct ModChangeFiles {
+        ModChangeFiles(const RE::TESFile* mod) : mod(mod) {}
+
+        const RE::TESFile* mod;
+        std::unique_ptr<ArenaDocument> shared;
+        std::unique_ptr<ArenaDocument> local;
+    };
+
+    using ChangeFileList = std::vector<ModChangeFiles>;
+
+    void ForEachChangeFile(const char* sub, const auto& fn);
+    void LoadChangesFromFolder(const char* sub, std::unique_ptr<ArenaDocument> ModChangeFiles::*layer,
+                               std::uint64_t ChangeFileHashes::*hash, ChangeFileList& files,
+                               const std::unordered_set<const RE::TESFile*>* only = nullptr);
+    std::unique_ptr<ArenaDocument> LoadFileChanges(std::filesystem::path path, std::uint64_t& hash);
+}
+
+namespace {
+    using namespace QuickArmorRebalance;
+
+    // Hands items from one thread to another, making the producer wait when the consumer falls behind
+    template <class T>
+    class BoundedQueue {
+    public:
+        explicit BoundedQueue(std::size_t capacity) : capacity(capacity) {}
+
+        void Push(T v) {
+            std::unique_lock lock(mutex);
+            notFull.wait(lock, [this]() { return items.size() < capacity; });
+            items.push_back(std::move(v));
+            notEmpty.notify_one();
+        }
+
+        // Empty once the queue is closed and drained
+        std::optional<T> Pop() {
+            std::unique_lock lock(mutex);
+            notEmpty.wait(lock, [this]() { return !items.empty() || bClosed; });
+            if (items.empty()) return std::nullopt;
+
+            T v = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+            return v;
+        }
+
+        void Close() {
+            std::lock_guard lock(mutex);
+            bClosed = true;
+            notEmpty.notify_all();
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable notFull;
+        std::condition_variable notEmpty;
+        std::deque<T> items;
+        std::size_t capacity;
+        bool bClosed = false;
+    };
+
+    // Same as rapidjson's FileReadStream, but hashes the contents as they're read so the file is only read once
+    class HashingFileReadStream {
+    public:
+        using Ch = char;
+
+        HashingFileReadStream(std::FILE* fp, char* buffer, std::size_t bufferSize)
+            : fp(fp), buffer(buffer), bufferSize(bufferSize), bufferLast(buffer), current(buffer) {
+            Read();
+        }
+
+        Ch Peek() const { return *current; }
+        Ch Take() {
+            Ch c = *current;
+            Read();
+            return c;
+        }
+        std::size_t Tell() const { return count + (std::size_t)(current - buffer); }
+
+        // Not used for reading
+        void Put(Ch) { RAPIDJSON_ASSERT(false); }
+        void Flush() { RAPIDJSON_ASSERT(false); }
+        Ch* PutBegin() { RAPIDJSON_ASSERT(false); return nullptr; }
+        std::size_t PutEnd(Ch*) { RAPIDJSON_ASSERT(false); return 0; }
+
+        std::uint64_t hash = HashFNV("");
+
+    private:
+        void Read() {
+            if (current < bufferLast) {
+                ++current;
+            } else if (!bEOF) {
+                count += readCount;
+                readCount = std::fread(buffer, 1, bufferSize - 1, fp);
+                hash = HashFNV({buffer, readCount}, hash);
+                bufferLast = buffer + readCount - 1;
+                current = buffer;
+
+                if (readCount < bufferSize - 1) {
+                    buffer[readCount] = '\0';
+                    ++bufferLast;
+                    bEOF = true;
+                }
+            }
+        }
+
+        std::FILE* fp;
+        char* buffer;
+        std::size_t bufferSize;
+        char* bufferLast;
+        char* current;
+        std::size_t readCount = 0;
+        std::size_t count = 0;
+        bool bEOF = false;
+    };
+
+    // One form's entry from a change file, in its own small document so it can be applied and freed on its own
+    struct ChangeEntry {
+        static constexpr std::size_t kChunkSize = 1024;  // Entries are a dozen or so short members
+
+        explicit ChangeEntry(RE::FormID id) : id(id) {}
+
+        RE::FormID id;
+        MemoryPoolAllocator<> allocator{kChunkSize};
+        Document doc{&allocator, kChunkSize};
+    };
+
+    using ChangeEntryQueue = BoundedQueue<std::unique_ptr<ChangeEntry>>;
+
+    // Reader events at the top of a change file open the root object and name each entry. Everything inside an
+    // entry is passed on to the document it's being read into
+    struct ChangeEntryHandler {
+        Document* entry = nullptr;
+        int depth = 0;  // Nesting within the entry
+        bool bInRoot = false;  // Anything else at the top means the file isn't an object
+        std::optional<RE::FormID> nextId;  // Set by an entry's name, the entry itself follows
+
+        bool Null() { return entry && entry->Null(); }
+        bool Bool(bool b) { return entry && entry->Bool(b); }
+        bool Int(int i) { return entry && entry->Int(i); }
+        bool Uint(unsigned i) { return entry && entry->Uint(i); }
+        bool Int64(std::int64_t i) { return entry && entry->Int64(i); }
+        bool Uint64(std::uint64_t i) { return entry && entry->Uint64(i); }
+        bool Double(double d) { return entry && entry->Double(d); }
+        bool RawNumber(const char* str, SizeType len, bool copy) { return entry && entry->RawNumber(str, len, copy); }
+        bool String(const char* str, SizeType len, bool copy) { return entry && entry->String(str, len, copy); }
+
+        bool StartObject() {
+            if (entry) {
+                depth++;
+                return entry->StartObject();
+            }
+            return bInRoot = true;
+        }
+
+        bool Key(const char* str, SizeType len, bool copy) {
+            if (entry) return entry->Key(str, len, copy);
+            nextId = (RE::FormID)atoi(str);
+            return true;
+        }
+
+        bool EndObject(SizeType n) {
+            if (!entry) return true;  // The root
+            depth--;
+            return entry->EndObject(n);
+        }
+
+        bool StartArray() {
+            if (!entry) return false;
+            depth++;
+            return entry->StartArray();
+        }
+
+        bool EndArray(SizeType n) {
+            depth--;
+            return entry->EndArray(n);
+        }
+    };
+
+    // Runs on its own thread, reading the file an entry at a time and queueing each one as soon as it's complete
+    void ReadChangeEntries(const std::filesystem::path& path, ChangeEntryQueue& queue, std::uint64_t& hash) {
+        // However reading ends, even by throwing, the consumer has to be told nothing more is coming or it waits
+        // forever
+        struct CloseOnExit {
+            ChangeEntryQueue& queue;
+            ~CloseOnExit() { queue.Close(); }
+        } closeOnExit{queue};
+
+        std::unique_ptr<std::FILE, decltype(&std::fclose)> fp(std::fopen(path.generic_string().c_str(), "rb"),
+                                                              &std::fclose);
+        if (!fp) {
+            logger::warn("{}: Couldn't open file", path.generic_string());
+            return;
+        }
+
+        char readBuffer[1 << 16];
+        HashingFileReadStream is(fp.get(), readBuffer, sizeof(readBuffer));
+        Reader reader;
+        ChangeEntryHandler handler;
+
+        auto readEntry = [&](Document& doc) {
+            handler.entry = &doc;
+            do {
+                if (!reader.IterativeParseNext<kParseDefaultFlags>(is, handler)) return false;
+            } while (handler.depth > 0);
+            handler.entry = nullptr;
+            return true;
+        };
+
+        std::size_t nQueued = 0;
+        reader.IterativeParseInit();
+        while (!reader.IterativeParseComplete()) {
+            if (!reader.IterativeParseNext<kParseDefaultFlags>(is, handler)) break;
+            if (!handler.nextId) continue;
+
+            auto entry = std::make_unique<ChangeEntry>(*handler.nextId);
+            handler.nextId.reset();
+
+            entry->doc.Populate(readEntry);
+            if (reader.HasParseError()) break;
+            queue.Push(std::move(entry));
+            nQueued++;
+        }
+
+        // Entries are applied as they're read, so unlike loading the whole file first, the ones before a parse error
+        // have already been applied by the time it's found
+        if (!handler.bInRoot)
+            logger::warn("{}: Unexpected contents, ignoring the file", path.generic_string());
+        else if (reader.HasParseError())
+            logger::warn("{}: JSON parse error: {} ({}), the {} changes before it were applied, the rest are skipped",
+                         path.generic_string(), GetParseError_En(reader.GetParseErrorCode()), reader.GetErrorOffset(),
+                         nQueued);
+
+        // The stream only hashed what was read, a file that stopped early is hashed whole so the next reload compares
+        // against the same thing
+        hash = reader.HasParseError() ? HashFile(path) : is.hash;
+    }
+
+    // Applies change files as if every shared entry were applied, in order, before any local one. A local change's
+    // source is then read with all the shared changes on it. A form with entries in both layers still has its shared
+    // entry held back and applied with the local one, as long as nothing in between reads the form or changes what
+    // the shared entry reads. Anything that does makes it apply on its own, at the point it would have anyway
+    class LayeredChangeLoader {
+    public:
+        // The local layers, which are only applied by ApplyLocal
+        explicit LayeredChangeLoader(const ChangeFileList& files) {
+            for (const auto& i : files) {
+                if (!i.local) continue;
+
+                for (auto& j : i.local->GetObj()) {
+                    RE::FormID id = atoi(j.name.GetString());
+                    auto fullId = GetFullId(i.mod, id);
+
+                    // Same as applying the file on its own, a repeated form keeps its first place and its last entry
+                    auto [it, inserted] = localIndex.try_emplace(fullId, locals.size());
+                    if (!inserted) {
+                        locals[it->second].value = &j.value;
+                        continue;
+                    }
+
+                    auto item = RE::TESForm::LookupByID<RE::TESBoundObject>(fullId);
+                    locals.push_back({i.mod, id, &j.value, item});
+                }
+            }
+
+            for (auto& i : locals) i.src = GetChangeSource(*i.value);
+        }
+
+        // Shared layers are fed in a file at a time, in load order
+        void BeginShared(const RE::TESFile* mod) {
+            sharedMod = mod;
+            applier = MakeChangeApplier(mod);
+        }
+
+        void AddShared(RE::FormID id, const Value* value, std::shared_ptr<void> owner = nullptr) {
+            auto fullId = GetFullId(sharedMod, id);
+            auto item = RE::TESForm::LookupByID<RE::TESBoundObject>(fullId);
+            auto src = GetChangeSource(*value);
+
+            // A held back entry has to be in place before anything reads its form or changes it or its source
+            if (src) FlushItem(src);
+            if (item) {
+                FlushItem(item);
+                for (auto it = deferredBySrc.find(item); it != deferredBySrc.end(); it = deferredBySrc.find(item))
+                    Flush(it->second);
+            }
+
+            if (item && localIndex.contains(fullId)) {
+                deferredByItem[item] = deferred.size();
+                if (src) deferredBySrc.emplace(src, deferred.size());
+                deferred.push_back({sharedMod, id, value, std::move(owner), item, src});
+                return;
+            }
+
+            applier->Add(id, value, nullptr, std::move(owner));
+        }
+
+        void EndShared() {
+            applier->Finish(true, false);
+            applier.reset();
+        }
+
+        // Applies the local layers once every shared one is in, returns how many forms had both applied together
+        int ApplyLocal() {
+            // A held back entry can only wait for its local one if no local change before that reads the form or
+            // changes the shared entry's source
+            std::unordered_set<RE::TESBoundObject*> read, written;
+            for (const auto& i : locals) {
+                if (auto it = deferredByItem.find(i.item); it != deferredByItem.end()) {
+                    auto& d = deferred[it->second];
+                    d.bMerge = !read.contains(i.item) && !written.contains(d.src);
+                }
+                if (i.src) read.insert(i.src);
+                if (i.item) written.insert(i.item);
+            }
+
+            for (std::size_t n = 0; n < deferred.size(); n++) {
+                if (!deferred[n].bMerge) Flush(n);
+            }
+
+            int nMerged = 0;
+            bool bShared = false;
+            for (auto& i : locals) {
+                if (!applier || sharedMod != i.mod) {
+                    if (applier) applier->Finish(bShared, true);
+                    sharedMod = i.mod;
+                    applier = MakeChangeApplier(i.mod);
+                    bShared = false;
+                }
+
+                const Value* shared = nullptr;
+                std::shared_ptr<void> owner;
+                if (auto it = deferredByItem.find(i.item); it != deferredByItem.end()) {
+                    auto& d = deferred[it->second];
+                    shared = d.value;
+                    owner = std::move(d.owner);
+                    bShared = true;
+                    nMerged++;
+                }
+
+                applier->Add(i.id, shared, i.value, std::move(owner));
+            }
+            if (applier) applier->Finish(bShared, true);
+            applier.reset();
+
+            return nMerged;
+        }
+
+        // Forms with entries in both layers
+        int GetOverlaps() const { return (int)deferred.size(); }
+
+    private:
+        struct LocalEntry {
+            const RE::TESFile* mod;
+            RE::FormID id;
+            const Value* value;
+            RE::TESBoundObject* item;
+            RE::TESBoundObject* src = nullptr;
+        };
+
+        struct DeferredEntry {
+            const RE::TESFile* mod;
+            RE::FormID id;
+            const Value* value;
+            std::shared_ptr<void> owner;
+            RE::TESBoundObject* item;
+            RE::TESBoundObject* src;
+            bool bMerge = false;
+            bool bApplied = false;
+        };
+
+        void FlushItem(RE::TESBoundObject* item) {
+            if (auto it = deferredByItem.find(item); it != deferredByItem.end()) Flush(it->second);
+        }
+
+        // Applies a held back shared entry on its own, after whatever is pending before it
+        void Flush(std::size_t n) {
+            auto& d = deferred[n];
+            if (d.bApplied) return;
+            d.bApplied = true;
+
+            deferredByItem.erase(d.item);
+            for (auto [it, end] = deferredBySrc.equal_range(d.src); it != end; ++it) {
+                if (it->second == n) {
+                    deferredBySrc.erase(it);
+                    break;
+                }
+            }
+
+            if (applier) applier->Flush();
+            if (ApplyChanges(d.mod, d.id, *d.value, g_Config.permShared))
+                g_Data.modifiedFilesShared.insert(d.mod);
+            else
+                logger::error("Failed to apply changes to {}:{:#08x}", d.mod->fileName, d.id);
+            d.owner.reset();
+        }
+
+        std::vector<LocalEntry> locals;
+        std::unordered_map<RE::FormID, std::size_t> localIndex;
+
+        std::vector<DeferredEntry> deferred;
+        std::unordered_map<RE::TESBoundObject*, std::size_t> deferredByItem;  // Only those still held back
+        std::unordered_multimap<RE::TESBoundObject*, std::size_t> deferredBySrc;
+
+        const RE::TESFile* sharedMod = nullptr;
+        std::unique_ptr<ChangeApplier> applier;
+    };
+
+    // Applies change files that are already loaded, every shared layer before any local one
+    void ApplyChangeFiles(const ChangeFileList& files) {
+        LayeredChangeLoader loader(files);
+        for (const auto& i : files) {
+            if (!i.shared) continue;
+
+            loader.BeginShared(i.mod);
+            for (auto& j : i.shared->GetObj()) loader.AddShared((RE::FormID)atoi(j.name.GetString()), &j.value);
+            loader.EndShared();
+        }
+        loader.ApplyLocal();
+    }
+
+    // Feeds a shared file to the loader an entry at a time, applying them while the rest is still being parsed
+    void StreamFileChanges(LayeredChangeLoader& loader, const RE::TESFile* mod, const std::filesystem::path& path) {
+        logger::trace("Streaming change file {}", path.filename().generic_string());
+
+        constexpr std::size_t kQueueSize = 64;
+        ChangeEntryQueue queue(kQueueSize);
+        std::uint64_t hash = 0;
+        auto reading =
+            std::async(std::launch::async, ReadChangeEntries, std::cref(path), std::ref(queue), std::ref(hash));
+
+        loader.BeginShared(mod);
+        while (auto entry = queue.Pop()) {
+            auto& e = **entry;
+            loader.AddShared(e.id, &e.doc, std::move(*entry));
+        }
+        reading.get();
+        loader.EndShared();
+
+        g_Data.changeFileHashes[mod].shared = hash;
+    }
 }
 
 using namespace QuickArmorRebalance;
 
 ProcessedData QuickArmorRebalance::g_Data;
 
-bool QuickArmorRebalance::IsValidItem(RE::TESBoundObject* i) {
-    auto mod = i->GetFile(0);
-    if (g_Config.blacklist.contains(mod)) return false;
+std::size_t QuickArmorRebalance::NameRegistry::FoldedHash::operator()(std::string_view str) const {
+    std::size_t hash = 14695981039346656037ull;
+    for (auto c : str) hash = (hash ^ (unsigned char)tolower(c)) * 1099511628211ull;
+    return hash;
+}
+
+bool QuickArmorRebalance::NameRegistry::FoldedEqual::operator()(std::string_view a, std::string_view b) const {
+    return a.size() == b.size() && !_strnicmp(a.data(), b.data(), a.size());
+}
+
+QuickArmorRebalance::NameID QuickArmorRebalance::NameRegistry::Intern(std::string_view name) {
+    if (auto it = ids.find(name); it != ids.end()) return it->second;
 
-    if (!i->GetPlayable() || i->IsDeleted() || i->IsIgnored() || !i->GetName() || i->IsDynamicForm()) return false;
+    auto id = (NameID)names.size();
+    ids.emplace(names.emplace_back(name), id);
+    return id;
+}
+
+QuickArmorRebalance::NameID QuickArmorRebalance::NameRegistry::Find(std::string_view name) const {
+    auto it = ids.find(name);
+    return it != ids.end() ? it->second : kNoName;
+}
+
+QuickArmorRebalance::OriginalsArena::Row QuickArmorRebalance::OriginalsArena::Add(RE::TESBoundObject* item) {
+    auto r = (Row)items.size();
+    rows[item] = r;
+
+    items.push_back(item);
+    rating.push_back(0);
+    armorType.push_back(0);
+    damage.push_back(0.0f);
+    critMult.push_back(0.0f);
+    speed.push_back(0.0f);
+    stagger.push_back(0.0f);
+    weight.push_back(0.0f);
+    value.push_back(0);
+    keywords.push_back({});
+    recipes.push_back({});
+    return r;
+}
 
-    if (auto armor = i->As<RE::TESObjectARMO>()) {
-        if (!armor->GetFullName() || armor->GetFullNameLength() <= 0) return false;
+namespace {
+    bool CheckValidItem(RE::TESBoundObject* i) {
+        auto mod = i->GetFile(0);
+        if (g_Config.blacklist.contains(mod)) return false;
 
-        /*
-        if (((unsigned int)armor->GetSlotMask() & g_Config.usedSlotsMask) == 0) {
-            // logger::debug("Skipping item for no valid slots {}", i->GetFullName());
+        if (!i->GetPlayable() || i->IsDeleted() || i->IsIgnored() || !i->GetName() || i->IsDynamicForm()) return false;
+
+        if (auto armor = i->As<RE::TESObjectARMO>()) {
+            if (!armor->GetFullName() || armor->GetFullNameLength() <= 0) return false;
+
+            /*
+            if (((unsigned int)armor->GetSlotMask() & g_Config.usedSlotsMask) == 0) {
+                // logger::debug("Skipping item for no valid slots {}", i->GetFullName());
+                return false;
+            }
+            */
+        } else if (auto weap = i->As<RE::TESObjectWEAP>()) {
+            if (!weap->GetFullName() || weap->GetFullNameLength() <= 0) return false;
+
+        } else if (auto ammo = i->As<RE::TESAmmo>()) {
+            if (!ammo->GetFullName() || ammo->GetFullNameLength() <= 0) return false;
+        } else
             return false;
-        }
-        */
-    } else if (auto weap = i->As<RE::TESObjectWEAP>()) {
-        if (!weap->GetFullName() || weap->GetFullNameLength() <= 0) return false;
 
-    } else if (auto ammo = i->As<RE::TESAmmo>()) {
-        if (!ammo->GetFullName() || ammo->GetFullNameLength() <= 0) return false;
-    } else
-        return false;
+        return true;
+    }
+}
+
+bool QuickArmorRebalance::IsValidItem(ItemStates::Ordinal o) {
+    // Validity only changes with the blacklist, so it's worked out once per form
+    auto& states = g_Data.itemStates;
+    auto& f = states.flags[o];
+
+    if (!(f & ItemStates::kValidChecked)) {
+        f |= ItemStates::kValidChecked;
+        if (CheckValidItem(states.items[o])) f |= ItemStates::kValid;
+    }
 
-    return true;
+    return (f & ItemStates::kValid) != 0;
 }
 
-void ProcessItem(RE::TESBoundObject* i) {
-    if (!IsValidItem(i)) return;
+bool QuickArmorRebalance::IsValidItem(RE::TESBoundObject* i) { return IsValidItem(g_Data.itemStates.Track(i)); }
 
+void QuickArmorRebalance::InvalidateValidItems(const RE::TESFile* mod) {
+    auto& states = g_Data.itemStates;
+    for (ItemStates::Ordinal o = 0; o < states.items.size(); o++) {
+        if (mod && states.items[o]->GetFile(0) != mod) continue;
+        states.flags[o] &= ~(ItemStates::kValid | ItemStates::kValidChecked);
+    }
+}
+
+void QuickArmorRebalance::AddModItem(RE::TESBoundObject* i) {
     auto mod = i->GetFile(0);
     auto it = g_Data.modData.find(mod);
     ModData* data = nullptr;
@@ -59,49 +569,173 @@ void ProcessItem(RE::TESBoundObject* i) {
         logger::trace("Added {}", mod->fileName);
     }
 
-    data->items.insert(i);
+    data->items.push_back(i);
 }
 
-void QuickArmorRebalance::ProcessData() {
-    auto dataHandler = RE::TESDataHandler::GetSingleton();
-
-    for (auto i : dataHandler->GetFormArray<RE::TESObjectARMO>()) {
-        ProcessItem(i);
+void QuickArmorRebalance::ModData::Finalize() {
+    auto typeOf = [](RE::TESBoundObject* i) {
+        if (i->As<RE::TESObjectARMO>()) return kArmor;
+        if (i->As<RE::TESObjectWEAP>()) return kWeapon;
+        return kAmmo;
+    };
+
+    std::sort(items.begin(), items.end(), [&](RE::TESBoundObject* const a, RE::TESBoundObject* const b) {
+        auto ta = typeOf(a), tb = typeOf(b);
+        if (ta != tb) return ta < tb;
+        return _stricmp(a->GetName(), b->GetName()) < 0;
+    });
+
+    auto& states = g_Data.itemStates;
+    std::fill(std::begin(typeStart), std::end(typeStart), (std::uint32_t)items.size());
+    slots.resize(items.size());
+    ordinals.resize(items.size());
+    for (auto n = items.size(); n-- > 0;) {
+        auto i = items[n];
+        typeStart[typeOf(i)] = (std::uint32_t)n;
+
+        auto o = ordinals[n] = states.Track(i);
+        auto armor = i->As<RE::TESObjectARMO>();
+        slots[n] = armor ? states.GetOriginalSlots(o, (ArmorSlots)armor->GetSlotMask()) : 0;
     }
 
-    for (auto i : dataHandler->GetFormArray<RE::TESObjectWEAP>()) {
-        ProcessItem(i);
+    // Empty type ranges start where the next type does
+    for (int t = kTypeCount - 1; t >= 0; t--) typeStart[t] = std::min(typeStart[t], typeStart[t + 1]);
+
+    populated = true;
+}
+
+// Builds the item list of one mod that hasn't been populated yet, returns false once every mod is done
+bool QuickArmorRebalance::PopulateNextMod() {
+    auto& next = g_Data.nextToPopulate;
+    while (next < g_Data.sortedMods.size()) {
+        auto mod = g_Data.sortedMods[next++];
+        if (!mod->populated) {
+            mod->Finalize();
+            return true;
+        }
     }
+    return false;
+}
+
+namespace {
+    constexpr std::size_t kScanChunkSize = 2048;
+
+    // Results of scanning one chunk of a form array, merged in chunk order so the outcome matches a serial scan
+    struct ScanShard {
+        ModGroups<RE::TESFile, RE::TESBoundObject> items;
+        std::vector<RE::TESBoundObject*> invalid;
 
-    for (auto i : dataHandler->GetFormArray<RE::TESAmmo>()) {
-        ProcessItem(i);
+        std::vector<std::pair<RE::TESBoundObject*, RE::BGSConstructibleObject*>> temper;
+        std::vector<std::pair<RE::TESBoundObject*, RE::BGSConstructibleObject*>> craft;
+
+        void AddItem(RE::TESBoundObject* i) {
+            if (!CheckValidItem(i)) {
+                invalid.push_back(i);
+                return;
+            }
+
+            items.Add(i->GetFile(0), i);
+        }
+    };
+
+    using ScanJob = std::function<void(ScanShard&)>;
+
+    template <class T>
+    void AddItemScanJobs(std::vector<ScanJob>& jobs, const RE::BSTArray<T*>& arr) {
+        for (std::size_t start = 0; start < arr.size(); start += kScanChunkSize) {
+            auto end = std::min<std::size_t>(start + kScanChunkSize, arr.size());
+            jobs.push_back([&arr, start, end](ScanShard& shard) {
+                for (auto n = start; n < end; n++) shard.AddItem(arr[(std::uint32_t)n]);
+            });
+        }
     }
 
-    if (!g_Data.sortedMods.empty()) {
-        std::sort(g_Data.sortedMods.begin(), g_Data.sortedMods.end(), [](ModData* const a, ModData* const b) {
-            return _stricmp(a->mod->GetFilename().data(), b->mod->GetFilename().data()) < 0;
-        });
+    void RunScanJobs(const std::vector<ScanJob>& jobs, std::vector<ScanShard>& shards) {
+        shards.resize(jobs.size());
+        ParallelFor(jobs.size(), [&](std::size_t n) { jobs[n](shards[n]); });
     }
 
-    auto temperBench = RE::TESForm::LookupByEditorID<RE::BGSKeyword>("CraftingSmithingArmorTable");
-    if (!temperBench) return;
+    void ScanForms() {
+        auto dataHandler = RE::TESDataHandler::GetSingleton();
+
+        auto temperBench = RE::TESForm::LookupByEditorID<RE::BGSKeyword>("CraftingSmithingArmorTable");
+        auto temperWeapBench = RE::TESForm::LookupByEditorID<RE::BGSKeyword>("CraftingSmithingSharpeningWheel");
+
+        std::vector<ScanJob> jobs;
+        AddItemScanJobs(jobs, dataHandler->GetFormArray<RE::TESObjectARMO>());
+        AddItemScanJobs(jobs, dataHandler->GetFormArray<RE::TESObjectWEAP>());
+        AddItemScanJobs(jobs, dataHandler->GetFormArray<RE::TESAmmo>());
+
+        auto& lsRecipies = dataHandler->GetFormArray<RE::BGSConstructibleObject>();
+        if (temperBench && temperWeapBench) {
+            for (std::size_t start = 0; start < lsRecipies.size(); start += kScanChunkSize) {
+                auto end = std::min<std::size_t>(start + kScanChunkSize, lsRecipies.size());
+                jobs.push_back([&, start, end](ScanShard& shard) {
+                    for (auto n = start; n < end; n++) {
+                        auto i = lsRecipies[(std::uint32_t)n];
+                        if (!i->createdItem) continue;
+                        auto pObj = i->createdItem->As<RE::TESBoundObject>();
+                        if (!pObj) continue;
+
+                        if (i->benchKeyword == temperBench || i->benchKeyword == temperWeapBench)
+                            shard.temper.push_back({pObj, i});
+                        else
+                            shard.craft.push_back({pObj, i});
+                    }
+                });
+            }
+        }
+
+        if (jobs.empty()) return;
+
+        std::vector<ScanShard> shards;
+        RunScanJobs(jobs, shards);
 
-    auto temperWeapBench = RE::TESForm::LookupByEditorID<RE::BGSKeyword>("CraftingSmithingSharpeningWheel");
-    if (!temperWeapBench) return;
+        g_Data.temperRecipes.recipes.reserve(lsRecipies.size() / 2);
+        g_Data.craftRecipes.recipes.reserve(lsRecipies.size() / 2);
 
-    auto& lsRecipies = dataHandler->GetFormArray<RE::BGSConstructibleObject>();
-    for (auto i : lsRecipies) {
-        if (!i->createdItem) continue;
-        auto pObj = i->createdItem->As<RE::TESBoundObject>();
-        if (!pObj) continue;
+        auto& states = g_Data.itemStates;
+        for (const auto& shard : shards) {
+            for (const auto& mod : shard.items.mods) {
+                for (auto i : mod.second) {
+                    states.flags[states.Track(i)] |= ItemStates::kValid | ItemStates::kValidChecked;
+                    AddModItem(i);
+                }
+            }
+            for (auto i : shard.invalid) states.flags[states.Track(i)] |= ItemStates::kValidChecked;
 
-        if (i->benchKeyword == temperBench || i->benchKeyword == temperWeapBench)
-            g_Data.temperRecipe.insert({pObj, i});
-        else
-            g_Data.craftRecipe.insert({pObj, i});
+            for (const auto& i : shard.temper) g_Data.temperRecipes.Add(i.first, i.second);
+            for (const auto& i : shard.craft) g_Data.craftRecipes.Add(i.first, i.second);
+        }
+
+        if (!g_Data.sortedMods.empty()) {
+            std::sort(g_Data.sortedMods.begin(), g_Data.sortedMods.end(), [](ModData* const a, ModData* const b) {
+                return _stricmp(a->mod->GetFilename().data(), b->mod->GetFilename().data()) < 0;
+            });
+            g_Data.nextToPopulate = 0;
+        }
     }
 }
 
+void QuickArmorRebalance::ProcessData() {
+    auto timeStart = std::chrono::steady_clock::now();
+    auto fingerprint = GetLoadOrderFingerprint();
+
+    bool bWarm = LoadDataSnapshot(fingerprint);
+    if (!bWarm) {
+        ScanForms();
+        SaveDataSnapshot(fingerprint);
+    }
+
+    auto ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - timeStart).count();
+    std::size_t nItems = 0;
+    for (auto mod : g_Data.sortedMods) nItems += mod->items.size();
+
+    // Per-mod item lists are sorted later, on first selection or while the UI is idle
+    logger::info("Processed {} mods ({} items) in {:.1f}ms ({})", g_Data.sortedMods.size(), nItems, ms,
+                 bWarm ? "snapshot" : "full scan");
+}
+
 void QuickArmorRebalance::LoadChangesFromFiles() {
     /*
     //Iterate from existing mods - probably slower so doing it the other way around
@@ -120,13 +754,24 @@ void QuickArmorRebalance::LoadChangesFromFiles() {
     */
 
     logger::info("Loading changes from files");
-    LoadChangesFromFolder("shared/", QuickArmorRebalance::g_Config.permShared);
+
+    // Shared packs can be large, so they're streamed in and applied while the rest of the file is still being parsed.
+    // Local files are read whole first, so the loader knows which shared entries to hold back for them
+    ChangeFileList files;
+    LoadChangesFromFolder("local/", &ModChangeFiles::local, &ChangeFileHashes::local, files);
+
+    LayeredChangeLoader loader(files);
+    ForEachChangeFile("shared/", [&](const RE::TESFile* mod, const std::filesystem::path& path) {
+        StreamFileChanges(loader, mod, path);
+    });
+    auto nMerged = loader.ApplyLocal();
+
     logger::info("{} items affected from shared changes", g_Data.modifiedItemsShared.size());
-    LoadChangesFromFolder("local/", QuickArmorRebalance::g_Config.permLocal);
     logger::info("{} items affected from local changes", g_Data.modifiedItems.size());
+    logger::info("{} items had both shared and local changes, {} applied in one pass", loader.GetOverlaps(), nMerged);
 }
 
-void QuickArmorRebalance::LoadChangesFromFolder(const char* sub, const Permissions& perm) {
+void QuickArmorRebalance::ForEachChangeFile(const char* sub, const auto& fn) {
     auto dataHandler = RE::TESDataHandler::GetSingleton();
 
     auto path = std::filesystem::current_path() / PATH_ROOT PATH_CHANGES;
@@ -146,41 +791,180 @@ void QuickArmorRebalance::LoadChangesFromFolder(const char* sub, const Permissio
         auto modName = entry.path().filename().generic_string();
         modName.resize(modName.size() - 5);  // strip ".json"
 
-        if (auto mod = dataHandler->LookupModByName(modName)) {
-            logger::trace("Loading change file {}", entry.path().filename().generic_string());
-            if (!LoadFileChanges(mod, entry.path(), perm))
-                logger::warn("Failed to load change file {}", entry.path().filename().generic_string());
-        }
+        if (auto mod = dataHandler->LookupModByName(modName)) fn(mod, entry.path());
     }
 }
 
-bool QuickArmorRebalance::LoadFileChanges(const RE::TESFile* mod, std::filesystem::path path, const Permissions& perm) {
-    Document doc;
+void QuickArmorRebalance::LoadChangesFromFolder(const char* sub,
+                                                std::unique_ptr<ArenaDocument> ModChangeFiles::*layer,
+                                                std::uint64_t ChangeFileHashes::*hash, ChangeFileList& files,
+                                                const std::unordered_set<const RE::TESFile*>* only) {
+    ForEachChangeFile(sub, [&](const RE::TESFile* mod, const std::filesystem::path& path) {
+        if (only && !only->contains(mod)) return;
+
+        logger::trace("Loading change file {}", path.filename().generic_string());
+        auto doc = LoadFileChanges(path, g_Data.changeFileHashes[mod].*hash);
+        if (!doc) {
+            logger::warn("Failed to load change file {}", path.filename().generic_string());
+            return;
+        }
 
-    if (auto fp = std::fopen(path.generic_string().c_str(), "rb")) {
-        char readBuffer[1 << 16];
-        FileReadStream is(fp, readBuffer, sizeof(readBuffer));
-        doc.ParseStream(is);
-        std::fclose(fp);
+        auto it = std::find_if(files.begin(), files.end(), [=](const auto& i) { return i.mod == mod; });
+        auto& modFiles = it != files.end() ? *it : files.emplace_back(mod);
+        modFiles.*layer = std::move(doc);
+    });
+}
 
-        if (doc.HasParseError()) {
-            logger::warn("{}: JSON parse error: {} ({})", path.generic_string(), GetParseError_En(doc.GetParseError()),
-                         doc.GetErrorOffset());
-            return false;
+std::unique_ptr<ArenaDocument> QuickArmorRebalance::LoadFileChanges(std::filesystem::path path,
+                                                                     std::uint64_t& hash) {
+    auto doc = std::make_unique<ArenaDocument>();
+
+    if (std::ifstream file{path, std::ios::binary}) {
+        // Read whole so the contents can be hashed for reloading, as well as parsed
+        std::string data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+        hash = HashFNV(data);
+        doc->Parse(data.data(), data.size());
+
+        if (doc->HasParseError()) {
+            logger::warn("{}: JSON parse error: {} ({})", path.generic_string(), GetParseError_En(doc->GetParseError()),
+                         doc->GetErrorOffset());
+            return nullptr;
         }
 
-        if (!doc.IsObject()) {
+        if (!doc->IsObject()) {
             logger::warn("{}: Unexpected contents, overwriting previous contents", path.generic_string());
-            return false;
+            return nullptr;
         }
     } else {
         logger::warn("{}: Couldn't open file", path.generic_string());
-        return false;
+        return nullptr;
+    }
+
+    return doc;
+}
+
+namespace {
+    // Reverts the mods' changes and applies their change files again, returning the forms that were reverted or
+    // changed. A change reads its source as it is at that point, so the mods whose changes read from these, and the
+    // mods with changes these read from, are redone with them. Otherwise they'd keep stats worked out from the old
+    // values, or read sources that already have every change on them rather than what load order had applied by then.
+    // Everything connected that way is redone in startup order, and nothing outside it reads or is read by it
+    std::unordered_set<RE::TESBoundObject*> RedoChanges(std::unordered_set<const RE::TESFile*>& mods,
+                                                        const auto& hasChanges) {
+        auto nRequested = mods.size();
+        auto add = [&](const RE::TESFile* mod) { return mods.insert(mod).second; };
+
+        ChangeFileList files;
+        for (;;) {
+            auto nMods = mods.size();
+
+            // What the changes read when they were last applied, followed both ways
+            for (bool bGrew = true; bGrew;) {
+                bGrew = false;
+                for (const auto& [mod, sources] : g_Data.changeSources) {
+                    bool bIn = mods.contains(mod);
+                    for (auto src : sources) {
+                        if (bIn && hasChanges(src)) {
+                            bGrew |= add(src);
+                        } else if (!bIn && mods.contains(src)) {
+                            add(mod);
+                            bIn = bGrew = true;
+                        }
+                    }
+                }
+            }
+
+            for (auto mod : mods) g_Data.changeFileHashes.erase(mod);
+
+            files.clear();
+            LoadChangesFromFolder("shared/", &ModChangeFiles::shared, &ChangeFileHashes::shared, files, &mods);
+            LoadChangesFromFolder("local/", &ModChangeFiles::local, &ChangeFileHashes::local, files, &mods);
+
+            // And what the files read now, which may not have been applied before
+            for (const auto& i : files) {
+                for (auto doc : {i.shared.get(), i.local.get()}) {
+                    if (!doc) continue;
+                    for (auto& j : doc->GetObj()) {
+                        auto src = GetChangeSource(j.value);
+                        if (src && hasChanges(src->GetFile(0))) add(src->GetFile(0));
+                    }
+                }
+            }
+
+            if (mods.size() == nMods) break;
+        }
+
+        if (mods.size() > nRequested)
+            logger::info("Redoing changes for {} more mods that read from or are read by the changed ones",
+                         mods.size() - nRequested);
+
+        std::unordered_set<RE::TESBoundObject*> touched;
+        for (auto i : g_Data.originals.items) {
+            if (mods.contains(i->GetFile(0)) && RevertChanges(i)) touched.insert(i);
+        }
+
+        for (auto mod : mods) {
+            g_Data.modifiedFiles.erase(mod);
+            g_Data.modifiedFilesShared.erase(mod);
+            g_Data.changeSources.erase(mod);
+        }
+
+        ApplyChangeFiles(files);
+
+        for (auto i : g_Data.modifiedItems) {
+            if (mods.contains(i->GetFile(0))) touched.insert(i);
+        }
+        for (auto i : g_Data.modifiedItemsShared) {
+            if (mods.contains(i->GetFile(0))) touched.insert(i);
+        }
+        return touched;
+    }
+}
+
+ReloadStats QuickArmorRebalance::ReloadChangedFiles() {
+    auto timeStart = std::chrono::steady_clock::now();
+    ReloadStats stats;
+
+    stats.bConfigChanged = g_Config.configHash != Config::HashConfigFiles();
+    if (stats.bConfigChanged) {
+        logger::info("Config files changed, reloading config");
+        if (!g_Config.Reload()) logger::error("Failed to reload configuration files");
     }
 
-    ApplyChanges(mod, doc.GetObj(), perm);
+    std::unordered_map<const RE::TESFile*, ChangeFileHashes> hashes;
+    ForEachChangeFile("shared/", [&](const RE::TESFile* mod, const std::filesystem::path& path) {
+        hashes[mod].shared = HashFile(path);
+    });
+    ForEachChangeFile("local/", [&](const RE::TESFile* mod, const std::filesystem::path& path) {
+        hashes[mod].local = HashFile(path);
+    });
+
+    // Permissions and keywords may have changed with the config, in which case every mod's changes are redone
+    std::unordered_set<const RE::TESFile*> dirty;
+    auto checkMod = [&](const RE::TESFile* mod) {
+        auto now = MapFindOr(hashes, mod, ChangeFileHashes{});
+        auto prev = MapFindOr(g_Data.changeFileHashes, mod, ChangeFileHashes{});
+        stats.nFilesChanged += (now.shared != prev.shared) + (now.local != prev.local);
+        if (stats.bConfigChanged || now != prev) dirty.insert(mod);
+    };
+    for (const auto& i : hashes) checkMod(i.first);
+    for (const auto& i : g_Data.changeFileHashes) {
+        if (!hashes.contains(i.first)) checkMod(i.first);
+    }
 
-    return true;
+    if (!dirty.empty()) {
+        // Mods that had changes applied, or have change files now
+        auto hasChanges = [&](const RE::TESFile* mod) {
+            return hashes.contains(mod) || g_Data.changeFileHashes.contains(mod);
+        };
+        stats.nFormsTouched = (int)RedoChanges(dirty, hasChanges).size();
+    }
+
+    stats.ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - timeStart).count();
+
+    logger::info("Reloaded {} changed files{} in {:.1f}ms, {} forms touched", stats.nFilesChanged,
+                 stats.bConfigChanged ? " and config" : "", stats.ms, stats.nFormsTouched);
+    return stats;
 }
 
 void QuickArmorRebalance::DeleteAllChanges(RE::TESFile* mod) {
@@ -191,5 +975,11 @@ void QuickArmorRebalance::DeleteAllChanges(RE::TESFile* mod) {
     if (!std::filesystem::exists(path)) return;
 
     std::filesystem::remove(path);
-    g_Data.modifiedFilesDeleted.insert(mod);
+
+    // Every form QAR touched has its originals captured, so the mod can be put back live and the shared changes
+    // re-applied on top
+    std::unordered_set<const RE::TESFile*> mods{mod};
+    auto touched = RedoChanges(mods, [](const RE::TESFile* i) { return g_Data.changeFileHashes.contains(i); });
+
+    logger::info("{}: Deleted local changes, {} items reverted or changed again", mod->fileName, touched.size());
 }
@@ -1,10 +1,11 @@
 #pragma once
 
+#include "ItemStates.h"
+#include "LootPlan.h"
+#include "RecipeIndex.h"
+
 namespace QuickArmorRebalance
 {
-    using ArmorSlot = unsigned int;
-    using ArmorSlots = unsigned int;
-
     static auto MapFindOr(const auto& map, const auto& val, const auto r) {
         auto it = map.find(val);
         if (it == map.end())
@@ -51,88 +52,244 @@ namespace QuickArmorRebalance
             : mod(mod)
 			{}
 
+        enum ItemType { kArmor, kWeapon, kAmmo, kTypeCount };
+
+        // Sorts items by type then display name and builds the slot and ordinal columns, call once all items are added
+        void Finalize();
+
+        // Item lists are only built when a mod is first looked at, until then items holds the unsorted candidates
+        void EnsurePopulated() {
+            if (!populated) Finalize();
+        }
+
         RE::TESFile* mod;
-        std::set<RE::TESBoundObject*> items;
+        std::vector<RE::TESBoundObject*> items;
+        std::vector<ArmorSlots> slots;  // Original slot mask per item, 0 for weapons and ammo
+        std::vector<ItemStates::Ordinal> ordinals;
+        std::uint32_t typeStart[kTypeCount + 1] = {};
+        bool populated = false;
 	};
 
-    struct LootDistGroup
-    {
-        std::string name;
-        int level = -1;
-        int early = 0;
-        int peak = 0;
-        int falloff = 0;
-        int minw = 1;
-        int maxw = 5;
+    using NameID = std::uint32_t;
+    constexpr NameID kNoName = ~NameID(0);
+
+    // Names of armor sets, curves and loot groups, looked up ignoring case and then referred to by a small stable ID.
+    // IDs are never reused, so they stay valid across config reloads
+    class NameRegistry {
+    public:
+        NameID Intern(std::string_view name);
+        NameID Find(std::string_view name) const;
+
+        const std::string& GetName(NameID id) const { return names[id]; }
+
+    private:
+        struct FoldedHash {
+            std::size_t operator()(std::string_view str) const;
+        };
+        struct FoldedEqual {
+            bool operator()(std::string_view a, std::string_view b) const;
+        };
+
+        std::deque<std::string> names;  // Keeps the first spelling seen, views into it stay valid
+        FlatMap<std::string_view, NameID, FoldedHash, FoldedEqual> ids;
     };
 
-    struct ContainerChance {
-        int count;
-        int chance;
+    struct LootDistGroup : LootCurve
+    {
+        std::string name;
     };
 
-    using ArmorSet = std::vector<RE::TESObjectARMO*>;
+    // The loot types below are allocator aware so that, when they live in ModLootData, everything they hold comes
+    // out of its arena too
+    using ArmorSet = std::pmr::vector<RE::TESObjectARMO*>;
 
     struct LootContainerGroup {
-        std::map<RE::TESForm*, ContainerChance> large;
-        std::map<RE::TESForm*, ContainerChance> small;
-        std::map<RE::TESForm*, ContainerChance> weapon;
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        LootContainerGroup(const allocator_type& al = {}) : large(al), small(al), weapon(al) {}
+
+        ContainerList large;
+        ContainerList small;
+        ContainerList weapon;
 
-        std::map<LootDistGroup*, std::vector<RE::TESBoundObject*>[3]> pieces;
-        std::map<LootDistGroup*, std::vector<const ArmorSet*>[3]> sets;
-        std::map<LootDistGroup*, std::vector<RE::TESBoundObject*>[3]> weapons;
+        // Position in containerGroups, which is keyed by NameID and so in the order names were first interned, not
+        // alphabetical. Orders the loot assignments
+        std::uint32_t index = 0;
     };
 
     struct LootDistProfile
     {
-        std::set<LootContainerGroup*> containerGroups;
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        LootDistProfile(const allocator_type& al = {}) : containerGroups(al) {}
+
+        std::pmr::set<LootContainerGroup*> containerGroups;
     };
 
     struct ItemDistData
     {
-        LootDistProfile* profile;
-        LootDistGroup* group;
-        int rarity;
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        ItemDistData(const allocator_type& al = {}) : set(al), setPieces(al) {}
 
-        RE::TESBoundObject* piece;
+        LootDistProfile* profile = nullptr;
+        LootDistGroup* group = nullptr;
+        int rarity = 0;
+
+        RE::TESBoundObject* piece = nullptr;
         ArmorSet set;
+        LootSet setPieces;  // The set with each piece's slots, filled in just before the lists are planned
+    };
+
+    using RecipeIndex = BasicRecipeIndex<RE::TESBoundObject, RE::BGSConstructibleObject>;
+
+    // Values forms had before QAR first changed them, so changes can be reverted or compared against live. Fixed size
+    // values are columns with one row per form, keywords and recipes live in side buffers that the rows index into
+    struct OriginalsArena
+    {
+        using Row = std::uint32_t;
+        static constexpr Row kNone = (Row)-1;
+
+        struct Span {
+            std::uint32_t start = 0;
+            std::uint32_t count = 0;
+        };
+
+        struct Recipe {
+            RE::BGSConstructibleObject* recipe;
+            RE::BGSKeyword* bench;
+            std::uint16_t numConstructed;
+            Span mats;
+            Span conditions;
+        };
+
+        Row Find(RE::TESBoundObject* item) const { return MapFindOr(rows, item, kNone); }
+
+        // Appends a row with every column zeroed, the caller fills in what applies to the form type
+        Row Add(RE::TESBoundObject* item);
+
+        std::span<RE::BGSKeyword* const> GetKeywords(Row r) const {
+            return {keywordBuffer.data() + keywords[r].start, keywords[r].count};
+        }
+        std::span<const Recipe> GetRecipes(Row r) const {
+            return {recipeBuffer.data() + recipes[r].start, recipes[r].count};
+        }
+
+        std::unordered_map<RE::TESBoundObject*, Row> rows;
+
+        std::vector<RE::TESBoundObject*> items;
+        std::vector<std::uint32_t> rating;  // Armor rating, or weapon attack damage
+        std::vector<std::uint32_t> armorType;
+        std::vector<float> damage;  // Weapon critical damage, or ammo damage
+        std::vector<float> critMult;
+        std::vector<float> speed;
+        std::vector<float> stagger;
+        std::vector<float> weight;
+        std::vector<std::int32_t> value;
+        std::vector<Span> keywords;
+        std::vector<Span> recipes;
+
+        std::vector<RE::BGSKeyword*> keywordBuffer;
+        std::vector<Recipe> recipeBuffer;
+        std::vector<std::pair<RE::TESBoundObject*, std::int32_t>> matBuffer;
+        std::vector<RE::CONDITION_ITEM_DATA> conditionBuffer;
+    };
+
+    // Content hashes of the change files loaded for a mod, 0 when there was no file
+    struct ChangeFileHashes {
+        std::uint64_t shared = 0;
+        std::uint64_t local = 0;
+
+        bool operator==(const ChangeFileHashes&) const = default;
     };
 
+    struct ReloadStats {
+        bool bConfigChanged = false;
+        int nFilesChanged = 0;
+        int nFormsTouched = 0;
+        float ms = 0.0f;
+    };
+
+    // Tracks how much the resources built on it have taken from the heap
+    class CountingResource : public std::pmr::memory_resource
+    {
+    public:
+        std::size_t GetBytes() const { return bytes; }
+        std::size_t GetBlocks() const { return blocks; }
+
+    private:
+        void* do_allocate(std::size_t size, std::size_t align) override {
+            bytes += size;
+            blocks++;
+            return std::pmr::new_delete_resource()->allocate(size, align);
+        }
+
+        void do_deallocate(void* p, std::size_t size, std::size_t align) override {
+            bytes -= size;
+            blocks--;
+            std::pmr::new_delete_resource()->deallocate(p, size, align);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+        std::size_t bytes = 0;
+        std::size_t blocks = 0;
+    };
+
+    // State used to build the loot lists. None of it is needed once the leveled lists exist, so all of it comes from
+    // one arena that's freed in a single step when this is destroyed
     struct ModLootData
     {
-        std::map<const ArmorSet*, RE::TESBoundObject*> setList;
+        CountingResource heap;
+        std::pmr::monotonic_buffer_resource arena{&heap};
 
-        std::map<std::string, LootContainerGroup> containerGroups;
-        std::map<std::string, LootDistProfile> distProfiles;
+        std::pmr::map<NameID, LootContainerGroup> containerGroups{&arena};
+        std::pmr::map<NameID, LootDistProfile> distProfiles{&arena};
 
-        std::map<RE::TESBoundObject*, ItemDistData> mapItemDist;
+        std::pmr::map<RE::TESBoundObject*, ItemDistData> mapItemDist{&arena};
+        std::pmr::vector<LootAssignment> assignments{&arena};
     };
 
 	struct ProcessedData
 	{
+        ItemStates itemStates;
 
-        std::map<RE::TESFile*, std::unique_ptr<ModData>> modData;
+        // Hashed rather than ordered, these are hit per row per frame by the UI and never iterated in order
+        std::unordered_map<RE::TESFile*, std::unique_ptr<ModData>> modData;
         std::vector<ModData*> sortedMods;
-        std::set<const RE::TESFile*> modifiedFiles;
-        std::set<const RE::TESFile*> modifiedFilesShared;
-        std::set<const RE::TESFile*> modifiedFilesDeleted;
+        std::size_t nextToPopulate = 0;  // PopulateNextMod's place in sortedMods, reset whenever that's reordered
+        std::unordered_set<const RE::TESFile*> modifiedFiles;
+        std::unordered_set<const RE::TESFile*> modifiedFilesShared;
 
-		std::set<RE::TESBoundObject*> modifiedItems;
-        std::set<RE::TESBoundObject*> modifiedItemsShared;
-        std::map<RE::TESBoundObject*, RE::BGSConstructibleObject*> temperRecipe;
-        std::map<RE::TESBoundObject*, RE::BGSConstructibleObject*> craftRecipe;
+        ItemFlagSet modifiedItems{itemStates, ItemStates::kModified};
+        ItemFlagSet modifiedItemsShared{itemStates, ItemStates::kModifiedShared};
+        RecipeIndex temperRecipes;
+        RecipeIndex craftRecipes;
 
-        std::map<RE::TESObjectARMO*, ArmorSlots> modifiedArmorSlots;
+        NameRegistry names;
 
         std::unique_ptr<ModLootData> loot;
-        std::map<std::string, LootDistGroup> distGroups;
+        std::map<NameID, LootDistGroup> distGroups;
+
+        OriginalsArena originals;
+        std::unordered_map<RE::TESBoundObject*, std::vector<RE::BGSConstructibleObject*>> createdRecipes;
+        std::unordered_map<const RE::TESFile*, ChangeFileHashes> changeFileHashes;
+
+        // For each mod with changes applied, the other mods whose forms those changes took as their source
+        std::unordered_map<const RE::TESFile*, std::unordered_set<const RE::TESFile*>> changeSources;
 
+        std::uint32_t changeRound = 0;  // Bumped whenever forms are changed or reverted
     };
 
+    bool IsValidItem(ItemStates::Ordinal o);
     bool IsValidItem(RE::TESBoundObject* i);
+    void InvalidateValidItems(const RE::TESFile* mod = nullptr);
 
 	void ProcessData();
+    void AddModItem(RE::TESBoundObject* i);
+    bool PopulateNextMod();
     void LoadChangesFromFiles();
+    ReloadStats ReloadChangedFiles();
 
     void DeleteAllChanges(RE::TESFile* mod);
 
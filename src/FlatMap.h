@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace QuickArmorRebalance {
+    // Hash map for the lookup heavy tables that are only ever added to. Entries are kept in one vector in the order
+    // they were added, and the table is an array of indexes into it that's probed linearly. A lookup reads two flat
+    // arrays instead of chasing a node per entry. Like a vector, adding can move every entry, so don't hold on to
+    // references or iterators across an insert
+    template <class Key, class Value, class Hash = std::hash<Key>, class Equal = std::equal_to<Key>>
+    class FlatMap
+    {
+    public:
+        using value_type = std::pair<Key, Value>;
+        using iterator = typename std::vector<value_type>::iterator;
+        using const_iterator = typename std::vector<value_type>::const_iterator;
+
+        iterator begin() { return entries.begin(); }
+        iterator end() { return entries.end(); }
+        const_iterator begin() const { return entries.begin(); }
+        const_iterator end() const { return entries.end(); }
+
+        std::size_t size() const { return entries.size(); }
+        bool empty() const { return entries.empty(); }
+
+        void reserve(std::size_t n) {
+            entries.reserve(n);
+            if (n > MaxLoad()) Rehash(n);
+        }
+
+        void clear() {
+            entries.clear();
+            std::fill(slots.begin(), slots.end(), kEmpty);
+        }
+
+        iterator find(const Key& key) {
+            auto i = Lookup(key);
+            return i != kEmpty ? entries.begin() + i : entries.end();
+        }
+
+        const_iterator find(const Key& key) const {
+            auto i = Lookup(key);
+            return i != kEmpty ? entries.begin() + i : entries.end();
+        }
+
+        bool contains(const Key& key) const { return Lookup(key) != kEmpty; }
+
+        template <class... Args>
+        std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) {
+            if (entries.size() + 1 > MaxLoad()) Rehash(entries.size() + 1);
+
+            auto s = Slot(key);
+            for (;; s = (s + 1) & mask) {
+                auto i = slots[s];
+                if (i == kEmpty) break;
+                if (Equal{}(entries[i].first, key)) return {entries.begin() + i, false};
+            }
+
+            slots[s] = (std::uint32_t)entries.size();
+            entries.emplace_back(std::piecewise_construct, std::forward_as_tuple(key),
+                                 std::forward_as_tuple(std::forward<Args>(args)...));
+            return {entries.end() - 1, true};
+        }
+
+        std::pair<iterator, bool> emplace(const Key& key, const Value& value) { return try_emplace(key, value); }
+
+        Value& operator[](const Key& key) { return try_emplace(key).first->second; }
+
+    private:
+        static constexpr std::uint32_t kEmpty = (std::uint32_t)-1;
+
+        // Pointer keys hash to themselves with some standard libraries, so the hash is mixed and the top bits used
+        // rather than masking off the aligned, always zero bottom ones
+        std::size_t Slot(const Key& key) const {
+            return (std::size_t)(((std::uint64_t)Hash{}(key) * 0x9e3779b97f4a7c15ull) >> shift);
+        }
+
+        std::uint32_t Lookup(const Key& key) const {
+            if (slots.empty()) return kEmpty;
+            for (auto s = Slot(key);; s = (s + 1) & mask) {
+                auto i = slots[s];
+                if (i == kEmpty || Equal{}(entries[i].first, key)) return i;
+            }
+        }
+
+        // Kept at most 3/4 full, so probes stay short
+        std::size_t MaxLoad() const { return slots.size() - slots.size() / 4; }
+
+        void Rehash(std::size_t n) {
+            std::size_t size = 16;
+            int bits = 4;
+            while (size - size / 4 < n) {
+                size *= 2;
+                bits++;
+            }
+
+            slots.assign(size, kEmpty);
+            mask = size - 1;
+            shift = 64 - bits;
+
+            for (std::uint32_t i = 0; i < entries.size(); i++) {
+                auto s = Slot(entries[i].first);
+                while (slots[s] != kEmpty) s = (s + 1) & mask;
+                slots[s] = i;
+            }
+        }
+
+        std::vector<value_type> entries;
+        std::vector<std::uint32_t> slots;
+        std::size_t mask = 0;
+        int shift = 64;
+    };
+}
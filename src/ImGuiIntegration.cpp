@@ -15,6 +15,7 @@
 namespace logger = SKSE::log;
 
 static void (*g_RenderCallback)() = nullptr;
+static void (*g_FrameCallback)() = nullptr;
 bool g_showImGui = false;
 bool g_blockInput = true;
 bool g_blockClicks = false;
@@ -117,6 +118,8 @@ struct DXGIPresentHook {
     static void thunk(std::uint32_t a_p1) {
         func(a_p1);
 
+        if (g_FrameCallback) g_FrameCallback();
+
         static int nSkippedFrames = 0;
 
         ImGui_ImplWin32_NewFrame(); //Let imgui clear out any queued messages and whatnot
@@ -549,8 +552,9 @@ struct InputFunc {
 ///////////////////////////////////////////////////////////////
 // Integration entry point
 
-bool ImGuiIntegration::Start(void callback()) {
+bool ImGuiIntegration::Start(void callback(), void frameCallback()) {
     g_RenderCallback = callback;
+    g_FrameCallback = frameCallback;
 
     SKSE::AllocTrampoline(14 * 2);
 
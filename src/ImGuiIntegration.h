@@ -2,7 +2,8 @@
 
 namespace ImGuiIntegration
 {
-    bool Start(void callback());
+    // frameCallback runs every frame, even while the UI is hidden
+    bool Start(void callback(), void frameCallback() = nullptr);
     void Show(bool toShow);
     void BlockInput(bool toBlock, bool toBlockClicks = false); //If block clicks is true, will still block those even if toBlock is false
 }
\ No newline at end of file
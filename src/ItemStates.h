@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "FlatMap.h"
+
+namespace RE {
+    class TESBoundObject;
+}
+
+namespace QuickArmorRebalance
+{
+    using ArmorSlot = unsigned int;
+    using ArmorSlots = unsigned int;
+
+    // Dense per-item state, every tracked item gets an ordinal and a slot in each column. The map is only for turning
+    // an item into its ordinal, lists that are walked per frame or per item keep the ordinal next to the item and
+    // index the columns directly
+    struct ItemStates
+    {
+        using Ordinal = std::uint32_t;
+        static constexpr Ordinal kNone = (Ordinal)-1;
+
+        enum Flag : std::uint8_t {
+            kValid = 1 << 0,
+            kModified = 1 << 1,
+            kModifiedShared = 1 << 2,
+            kSlotsOverridden = 1 << 3,
+            kUnchecked = 1 << 4,
+            kSelected = 1 << 5,
+            kValidChecked = 1 << 6,  // kValid is only meaningful once this is set
+        };
+
+        Ordinal Track(RE::TESBoundObject* item) {
+            auto [it, inserted] = ordinals.try_emplace(item, (Ordinal)items.size());
+            if (inserted) {
+                items.push_back(item);
+                flags.push_back(0);
+                origSlots.push_back(0);
+            }
+            return it->second;
+        }
+
+        Ordinal Find(RE::TESBoundObject* item) const {
+            auto it = ordinals.find(item);
+            return it != ordinals.end() ? it->second : kNone;
+        }
+
+        std::uint8_t Get(Ordinal o) const { return o != kNone ? flags[o] : 0; }
+        std::uint8_t Get(RE::TESBoundObject* item) const { return Get(Find(item)); }
+
+        // Slots the item had before any QAR remapping, current being what it has now
+        ArmorSlots GetOriginalSlots(Ordinal o, ArmorSlots current) const {
+            return o != kNone && (flags[o] & kSlotsOverridden) ? origSlots[o] : current;
+        }
+
+        void SetOriginalSlots(Ordinal o, ArmorSlots slots) {
+            origSlots[o] = slots;
+            flags[o] |= kSlotsOverridden;
+        }
+
+        FlatMap<RE::TESBoundObject*, Ordinal> ordinals;
+        std::vector<RE::TESBoundObject*> items;
+        std::vector<std::uint8_t> flags;
+        std::vector<ArmorSlots> origSlots;
+    };
+
+    // Set-like view over a single ItemStates flag
+    class ItemFlagSet
+    {
+    public:
+        ItemFlagSet(ItemStates& states, std::uint8_t flag) : states(states), flag(flag) {}
+
+        class iterator
+        {
+        public:
+            iterator(const ItemFlagSet* set, ItemStates::Ordinal o) : set(set), o(o) { Skip(); }
+
+            RE::TESBoundObject* operator*() const { return set->states.items[o]; }
+            iterator& operator++() {
+                o++;
+                Skip();
+                return *this;
+            }
+            bool operator==(const iterator& rhs) const { return o == rhs.o; }
+
+        private:
+            void Skip() {
+                while (o < set->states.flags.size() && !(set->states.flags[o] & set->flag)) o++;
+            }
+
+            const ItemFlagSet* set;
+            ItemStates::Ordinal o;
+        };
+
+        iterator begin() const { return {this, 0}; }
+        iterator end() const { return {this, (ItemStates::Ordinal)states.flags.size()}; }
+
+        bool contains(ItemStates::Ordinal o) const { return (states.Get(o) & flag) != 0; }
+        bool contains(RE::TESBoundObject* i) const { return contains(states.Find(i)); }
+
+        void insert(ItemStates::Ordinal o) {
+            auto& f = states.flags[o];
+            if (!(f & flag)) count++;
+            f |= flag;
+        }
+
+        void insert(RE::TESBoundObject* i) { insert(states.Track(i)); }
+
+        void insert(auto first, auto last) {
+            for (; first != last; ++first) insert(*first);
+        }
+
+        void erase(ItemStates::Ordinal o) {
+            if (o == ItemStates::kNone || !(states.flags[o] & flag)) return;
+            states.flags[o] &= ~flag;
+            count--;
+        }
+
+        void erase(RE::TESBoundObject* i) { erase(states.Find(i)); }
+
+        void clear() {
+            if (!count) return;
+            for (auto& f : states.flags) f &= ~flag;
+            count = 0;
+        }
+
+        std::size_t size() const { return count; }
+        bool empty() const { return !count; }
+
+    private:
+        ItemStates& states;
+        std::uint8_t flag;
+        std::size_t count = 0;
+    };
+}
@@ -0,0 +1,84 @@
+#include "JsonArena.h"
+
+#include <mutex>
+
+namespace {
+    constexpr std::size_t kMaxSpareArenas = 16;
+    constexpr std::size_t kMaxArenaSize = 4 << 20;  // Anything larger is rare enough to go back to the heap
+
+    struct Arena {
+        std::unique_ptr<char[]> buffer;
+        std::size_t size = 0;
+    };
+
+    std::atomic<std::size_t> g_chunkSize = rapidjson::MemoryPoolAllocator<>::kDefaultChunkCapacity;
+
+    std::atomic<std::size_t> g_nDocuments = 0;
+    std::atomic<std::size_t> g_nReused = 0;
+    std::atomic<std::size_t> g_nHeapAllocs = 0;
+    std::atomic<std::size_t> g_nPeakBytes = 0;
+
+    // Shared rather than per thread, config files are parsed on workers but their documents die on the main thread
+    std::mutex g_arenaLock;
+    std::vector<Arena> g_arenas;
+
+    Arena AllocArena(std::size_t size) {
+        g_nHeapAllocs++;
+        return {std::make_unique<char[]>(size), size};
+    }
+}
+
+QuickArmorRebalance::detail::ArenaLease::ArenaLease() {
+    g_nDocuments++;
+
+    Arena arena;
+    {
+        std::lock_guard lock(g_arenaLock);
+        if (!g_arenas.empty()) {
+            arena = std::move(g_arenas.back());
+            g_arenas.pop_back();
+        }
+    }
+
+    if (arena.buffer)
+        g_nReused++;
+    else
+        arena = AllocArena(g_chunkSize);
+
+    buffer = std::move(arena.buffer);
+    nSize = arena.size;
+}
+
+QuickArmorRebalance::detail::ArenaLease::~ArenaLease() {
+    auto peak = g_nPeakBytes.load();
+    while (used > peak && !g_nPeakBytes.compare_exchange_weak(peak, used)) {
+    }
+
+    Arena arena{std::move(buffer), nSize};
+
+    // Whatever the pool needed past the arena came from the heap a chunk at a time
+    if (capacity > arena.size) {
+        auto chunkSize = g_chunkSize.load();
+        g_nHeapAllocs += (capacity - arena.size + chunkSize - 1) / chunkSize;
+        if (capacity > kMaxArenaSize) return;
+        arena = AllocArena(capacity + chunkSize);
+    }
+
+    std::lock_guard lock(g_arenaLock);
+    if (g_arenas.size() < kMaxSpareArenas) g_arenas.push_back(std::move(arena));
+}
+
+QuickArmorRebalance::detail::ArenaAllocator::ArenaAllocator()
+    : allocator(lease.data(), lease.size(), g_chunkSize) {}
+
+QuickArmorRebalance::ArenaDocument::~ArenaDocument() {
+    lease.used = allocator.Size();
+    lease.capacity = allocator.Capacity();
+}
+
+void QuickArmorRebalance::SetJsonChunkSize(std::size_t size) { g_chunkSize = std::max<std::size_t>(size, 4096); }
+
+void QuickArmorRebalance::LogJsonArenaStats() {
+    logger::info("JSON documents: {}, {} reused an arena, {} heap allocations, peak {} KB in one document",
+                 g_nDocuments.load(), g_nReused.load(), g_nHeapAllocs.load(), g_nPeakBytes.load() >> 10);
+}
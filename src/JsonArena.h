@@ -0,0 +1,52 @@
+#pragma once
+
+namespace QuickArmorRebalance {
+    namespace detail {
+        // The memory a document's pool starts out with, borrowed from the spare arenas all threads share and
+        // given back to them when it's released
+        class ArenaLease {
+        public:
+            ArenaLease();
+            ~ArenaLease();
+
+            ArenaLease(const ArenaLease&) = delete;
+            ArenaLease& operator=(const ArenaLease&) = delete;
+
+            char* data() const { return buffer.get(); }
+            std::size_t size() const { return nSize; }
+
+            // Filled in by the document before it goes, so an arena it outgrew is replaced by one that fits
+            std::size_t used = 0;
+            std::size_t capacity = 0;
+
+        private:
+            std::unique_ptr<char[]> buffer;
+            std::size_t nSize = 0;
+        };
+
+        // Constructed ahead of the document so the document can be given its allocator. The pool keeps its own
+        // bookkeeping in the arena, so the lease has to outlive it
+        struct ArenaAllocator {
+            ArenaAllocator();
+
+            ArenaLease lease;
+            rapidjson::MemoryPoolAllocator<> allocator;
+        };
+    }
+
+    // A rapidjson document whose memory pool is backed by a reusable arena, instead of taking chunks from the heap
+    // and freeing them again for every file
+    class ArenaDocument : private detail::ArenaAllocator, public rapidjson::Document {
+    public:
+        ArenaDocument() : rapidjson::Document(&allocator) {}
+        ~ArenaDocument();
+
+        ArenaDocument(const ArenaDocument&) = delete;
+        ArenaDocument& operator=(const ArenaDocument&) = delete;
+    };
+
+    // Size of a new arena, and of each chunk a document takes from the heap once it outgrows its arena
+    void SetJsonChunkSize(std::size_t size);
+
+    void LogJsonArenaStats();
+}
@@ -4,6 +4,8 @@
 #include "ArmorSetBuilder.h"
 #include "Config.h"
 #include "Data.h"
+#include "LootPlan.h"
+#include "Resolver.h"
 
 /*//////////////////
 Loot table notes
@@ -36,7 +38,7 @@ Value QuickArmorRebalance::MakeLootChanges(const ArmorChangeParams& params, RE::
     for (auto item : params.items) //Don't build loot sets from current armor (aka mixed mod sets) - maybe in the future
         if (item->GetFile(0) != i->GetFile(0)) return {};
 
-    if (!params.isWornArmor && params.bDistribute && params.distProfile) {
+    if (!params.isWornArmor && params.bDistribute && params.distProfile != kNoName) {
         Value loot(kObjectType);
 
         if (auto armor = i->As<RE::TESObjectARMO>()) {
@@ -69,7 +71,7 @@ Value QuickArmorRebalance::MakeLootChanges(const ArmorChangeParams& params, RE::
         }
 
         if (!loot.ObjectEmpty()) {
-            loot.AddMember("profile", Value(params.distProfile, al), al);
+            loot.AddMember("profile", Value(g_Data.names.GetName(params.distProfile).c_str(), al), al);
             loot.AddMember("group", Value(params.armorSet->loot->name.c_str(), al), al);
             loot.AddMember("rarity", params.rarity, al);
             return loot;
@@ -86,7 +88,7 @@ void QuickArmorRebalance::LoadLootChanges(RE::TESBoundObject* item, const Value&
     const auto& jsonProfile = jsonLoot["profile"];
     if (!jsonProfile.IsString()) return;
 
-    const auto& itProfile = g_Data.loot->distProfiles.find(jsonProfile.GetString());
+    const auto& itProfile = g_Data.loot->distProfiles.find(g_Data.names.Find(jsonProfile.GetString()));
     if (itProfile == g_Data.loot->distProfiles.end()) return;
 
     if (!jsonLoot.HasMember("rarity") || !jsonLoot["rarity"].IsInt()) return;
@@ -95,39 +97,39 @@ void QuickArmorRebalance::LoadLootChanges(RE::TESBoundObject* item, const Value&
     const auto& jsonGroup = jsonLoot["group"];
     if (!jsonGroup.IsString()) return;
 
-    const auto& itGroup = g_Data.distGroups.find(jsonGroup.GetString());
+    const auto& itGroup = g_Data.distGroups.find(g_Data.names.Find(jsonGroup.GetString()));
     if (itGroup == g_Data.distGroups.end()) return;
 
     auto profile = &itProfile->second;
     auto group = &itGroup->second;
     int rarity = std::clamp(jsonLoot["rarity"].GetInt(), 0, 2);
 
-    RE::TESBoundObject* piece = nullptr;
-    ArmorSet items;
-
-    if (jsonLoot.HasMember("piece") && jsonLoot["piece"].GetBool()) piece = item;
+    auto& data = g_Data.loot->mapItemDist[item];
+    data.profile = profile;
+    data.group = group;
+    data.rarity = rarity;
+    data.piece = jsonLoot.HasMember("piece") && jsonLoot["piece"].GetBool() ? item : nullptr;
+    data.set.clear();
 
     if (auto armor = item->As<RE::TESObjectARMO>()) {
         if (jsonLoot.HasMember("set")) {
             for (const auto& i : jsonLoot["set"].GetArray()) {
                 RE::FormID id = GetFullId(item->GetFile(), i.GetUint());
 
-                if (auto setitem = RE::TESForm::LookupByID<RE::TESObjectARMO>(id)) items.push_back(setitem);
+                if (auto setitem = RE::TESForm::LookupByID<RE::TESObjectARMO>(id)) data.set.push_back(setitem);
             }
         }
     }
-
-    g_Data.loot->mapItemDist[item] = {profile, group, rarity, piece, std::move(items)};
 }
 
-void LoadContainerList(std::map<RE::TESForm*, QuickArmorRebalance::ContainerChance>& set, const Value& jsonList) {
-    auto dataHandler = RE::TESDataHandler::GetSingleton();
+void LoadContainerList(QuickArmorRebalance::ContainerList& set, const Value& jsonList,
+                       QuickArmorRebalance::NameResolver& resolver) {
     if (!jsonList.IsObject()) return;
     for (const auto& jsonFiles : jsonList.GetObj()) {
-        if (auto file = dataHandler->LookupModByName(jsonFiles.name.GetString())) {
+        if (auto file = resolver.FindMod(jsonFiles.name.GetString())) {
             if (!jsonFiles.value.IsObject()) continue;
             for (const auto& entry : jsonFiles.value.GetObj()) {
-                if (auto form = QuickArmorRebalance::FindIn<RE::TESForm>(file, entry.name.GetString())) {
+                if (auto form = resolver.FindIn(file, entry.name.GetString())) {
                     if (form->As<RE::TESContainer>() || form->As<RE::TESLevItem>()) {
                         if (entry.value.IsObject()) {
                             auto num = GetJsonInt(entry.value, "num", 1, 20);
@@ -140,22 +142,25 @@ void LoadContainerList(std::map<RE::TESForm*, QuickArmorRebalance::ContainerChan
 
                     } else
                         logger::warn("Item not container or leveled list: {}", entry.name.GetString());
-                } else
+                } else if (resolver.IsFirstMiss("Item", entry.name.GetString()))
                     logger::warn("Item not found: {}", entry.name.GetString());
             }
         }
     }
 }
 
-void QuickArmorRebalance::LoadLootConfig(const Value& jsonLoot) {
+void QuickArmorRebalance::LoadLootConfig(const Value& jsonLoot, NameResolver& resolver) {
     if (jsonLoot.HasMember("containerGroups")) {
         const auto& jsonGroups = jsonLoot["containerGroups"];
         if (jsonGroups.IsObject()) {
             for (const auto& jsonGroup : jsonGroups.GetObj()) {
-                auto& group = g_Data.loot->containerGroups[jsonGroup.name.GetString()];
-                if (jsonGroup.value.HasMember("sets")) LoadContainerList(group.large, jsonGroup.value["sets"]);
-                if (jsonGroup.value.HasMember("pieces")) LoadContainerList(group.small, jsonGroup.value["pieces"]);
-                if (jsonGroup.value.HasMember("weapons")) LoadContainerList(group.weapon, jsonGroup.value["weapons"]);
+                auto& group = g_Data.loot->containerGroups[g_Data.names.Intern(jsonGroup.name.GetString())];
+                if (jsonGroup.value.HasMember("sets"))
+                    LoadContainerList(group.large, jsonGroup.value["sets"], resolver);
+                if (jsonGroup.value.HasMember("pieces"))
+                    LoadContainerList(group.small, jsonGroup.value["pieces"], resolver);
+                if (jsonGroup.value.HasMember("weapons"))
+                    LoadContainerList(group.weapon, jsonGroup.value["weapons"], resolver);
             }
         }
     }
@@ -164,7 +169,7 @@ void QuickArmorRebalance::LoadLootConfig(const Value& jsonLoot) {
         const auto& jsonGroups = jsonLoot["distGroups"];
         if (jsonGroups.IsObject()) {
             for (const auto& jsonGroup : jsonGroups.GetObj()) {
-                auto& group = g_Data.distGroups[jsonGroup.name.GetString()];
+                auto& group = g_Data.distGroups[g_Data.names.Intern(jsonGroup.name.GetString())];
 
                 group.name = jsonGroup.name.GetString();
                 group.level = GetJsonInt(jsonGroup.value, "level", 1, 255);
@@ -181,16 +186,19 @@ void QuickArmorRebalance::LoadLootConfig(const Value& jsonLoot) {
         const auto& jsonGroups = jsonLoot["distProfiles"];
         if (jsonGroups.IsObject()) {
             for (const auto& jsonGroup : jsonGroups.GetObj()) {
-                g_Config.lootProfiles.insert(jsonGroup.name.GetString());
+                auto id = g_Data.names.Intern(jsonGroup.name.GetString());
+                auto& profiles = g_Config.lootProfiles;
+                if (std::find(profiles.begin(), profiles.end(), id) == profiles.end()) profiles.push_back(id);
 
-                auto& group = g_Data.loot->distProfiles[jsonGroup.name.GetString()];
+                auto& group = g_Data.loot->distProfiles[id];
 
                 if (jsonGroup.value.HasMember("in")) {
                     const auto& jsonIn = jsonGroup.value["in"];
                     if (!jsonIn.IsArray()) continue;
                     for (const auto& name : jsonIn.GetArray()) {
                         if (!name.IsString()) continue;
-                        group.containerGroups.insert(&g_Data.loot->containerGroups[name.GetString()]);
+                        auto containerGroup = g_Data.names.Intern(name.GetString());
+                        group.containerGroups.insert(&g_Data.loot->containerGroups[containerGroup]);
                     }
                 }
             }
@@ -201,18 +209,18 @@ void QuickArmorRebalance::LoadLootConfig(const Value& jsonLoot) {
 void QuickArmorRebalance::ValidateLootConfig() {
     for (const auto& i : g_Data.loot->containerGroups) {
         if (i.second.small.empty() && i.second.large.empty())
-            logger::warn("Loot container group {} has no associated containers", i.first);
+            logger::warn("Loot container group {} has no associated containers", g_Data.names.GetName(i.first));
     }
 
     for (const auto& i : g_Data.distGroups) {
         if (i.second.level < 0)
-            logger::warn("Loot distribution group {} is referenced by an armor set but does not exist (case sensitive)",
-                         i.first);
+            logger::warn("Loot distribution group {} is referenced by an armor set but does not exist",
+                         g_Data.names.GetName(i.first));
     }
 
     for (const auto& i : g_Data.loot->distProfiles) {
         if (i.second.containerGroups.empty())
-            logger::warn("Loot profile group {} has no associated container groups", i.first);
+            logger::warn("Loot profile group {} has no associated container groups", g_Data.names.GetName(i.first));
     }
 }
 
@@ -221,8 +229,6 @@ namespace {
 
     int g_nLListsCreated = 0;
 
-    const size_t kLLMaxSize = 0xff;  // Not 0x100 because num_entries would roll to 0 at max size
-
     RE::TESLevItem* CreateLeveledList() {
         auto dataHandler = RE::TESDataHandler::GetSingleton();
 
@@ -256,257 +262,47 @@ namespace {
         logger::info(">>>End list<<<");
     }
 
-    template <class T>
-    RE::TESBoundObject* BuildListFrom(T* const* items, size_t count, uint8_t flags, uint8_t chanceNone = 0) {
-        if (!count) return nullptr;
-        if (count == 1 && !chanceNone) return const_cast<T*>(*items);
-        if (count <= kLLMaxSize) {
-            auto list = CreateLeveledList();
-            list->llFlags = (RE::TESLeveledList::Flag)flags;
-            list->entries.resize(list->numEntries = (uint8_t)count);
-            list->chanceNone = chanceNone;
-            for (int i = 0; i < count; i++) {
-                auto& e = list->entries[i];
-                e.count = 1;
-                e.form = items[i];
-                e.level = 1;
-                e.itemExtra = nullptr;
-            }
-            //LogListContents(list);
-            return list;
-        } else {
-            auto split = 1 + count / kLLMaxSize;
-            auto slice = count / split;
+    // Creates the planned lists in order, then adds the top ones to their containers. The only part of the loot build
+    // that touches the game's forms, so it stays on this thread
+    void MaterializeLootPlan(const LootPlan& plan) {
+        static_assert((int)LootPlan::List::kCalculateForEachItemInCount ==
+                      (int)RE::TESLeveledList::kCalculateForEachItemInCount);
+        static_assert((int)LootPlan::List::kUseAll == (int)RE::TESLeveledList::kUseAll);
 
+        std::vector<RE::TESBoundObject*> forms;
+        forms.reserve(plan.lists.size());
+
+        auto resolve = [&](const LootRef& ref) -> RE::TESBoundObject* {
+            return ref.type == LootRef::Type::List ? forms[ref.index] : ref.form;
+        };
+
+        for (const auto& i : plan.lists) {
             auto list = CreateLeveledList();
-            list->llFlags = (RE::TESLeveledList::Flag)flags;
-            list->entries.resize(split);
-            list->chanceNone = chanceNone;
-            auto front = items;
-            for (int i = 0; i < split; i++) {
-                auto& e = list->entries[i];
-                e.count = 1;
-                e.form = BuildListFrom(front, count > kLLMaxSize ? slice : count, flags);
-                e.level = 1;
+            list->llFlags = (RE::TESLeveledList::Flag)i.flags;
+            list->chanceNone = i.chanceNone;
+            list->entries.resize(list->numEntries = (uint8_t)i.entries.size());
+            for (int n = 0; n < list->numEntries; n++) {
+                auto& e = list->entries[n];
+                e.count = i.entries[n].count;
+                e.form = resolve(i.entries[n].ref);
+                e.level = i.entries[n].level;
                 e.itemExtra = nullptr;
-
-                front += slice;
-                count -= slice;
             }
-
             //LogListContents(list);
-            return list;
-        }
-    }
-
-    RE::TESBoundObject* BuildListFrom(const std::vector<RE::TESObjectARMO*>& items, uint8_t flags) {
-        return BuildListFrom(items.data(), items.size(), flags);
-    }
-
-    RE::TESBoundObject* BuildListFrom(const std::vector<RE::TESBoundObject*>& items, uint8_t flags) {
-        return BuildListFrom(items.data(), items.size(), flags);
-    }
-
-    RE::TESBoundObject* BuildContentList(const std::vector<RE::TESBoundObject*>& contents) {
-        if (!QuickArmorRebalance::g_Config.bNormalizeModDrops)
-            return BuildListFrom(contents, RE::TESLeveledList::kCalculateForEachItemInCount);
-
-        std::vector<RE::TESBoundObject*> modLists;
-        std::map<RE::TESFile*, std::vector<RE::TESBoundObject*>> map;
-
-        for (auto i : contents) map[i->GetFile(0)].push_back(i);
-        for (const auto& i : map)
-        {
-            modLists.push_back(BuildListFrom(i.second, RE::TESLeveledList::kCalculateForEachItemInCount));
-        }
-
-        return BuildListFrom(modLists, RE::TESLeveledList::kCalculateForEachItemInCount);
-    }
-
-    RE::TESBoundObject* BuildArmorSetList(const QuickArmorRebalance::ArmorSet* set) {
-        auto it = QuickArmorRebalance::g_Data.loot->setList.find(set);
-        if (it != QuickArmorRebalance::g_Data.loot->setList.end()) return it->second;
-
-        unsigned int covered = 0;
-        std::vector<RE::TESBoundObject*> pieces;
-
-        for (auto i : *set) {
-            if (covered & (unsigned int)i->GetSlotMask()) continue;
-
-            unsigned int slots = (unsigned int)i->GetSlotMask();
-            std::vector<RE::TESObjectARMO*> conflicts;
-
-            // Two passes - first find potential conflicts, then pick them out
-            // This has to happen just to cover weird situations where pieces overlap inconsistently
-            // Technically would require repeating until it stops changing, but you'd have to design an armor set just
-            // to be obnoxious intentionally
-            for (auto j : *set)
-                if (slots & (unsigned int)j->GetSlotMask()) slots |= (unsigned int)j->GetSlotMask();
-            for (auto j : *set)
-                if (slots & (unsigned int)j->GetSlotMask()) conflicts.push_back(j);
-
-            if (conflicts.size() > 1)
-                pieces.push_back(BuildListFrom(conflicts, 0));
-            else
-                pieces.push_back(i);
-
-            covered |= slots;
-        }
-
-        return QuickArmorRebalance::g_Data.loot->setList[set] = BuildListFrom(pieces, RE::TESLeveledList::kUseAll);
-    }
-
-    RE::TESBoundObject* BuildContentList(const std::vector<const QuickArmorRebalance::ArmorSet*>& contents) {
-        if (!QuickArmorRebalance::g_Config.bNormalizeModDrops) {
-            std::vector<RE::TESBoundObject*> sets;
-
-            for (auto i : contents) sets.push_back(BuildArmorSetList(i));
-
-            return BuildListFrom(sets, RE::TESLeveledList::kCalculateForEachItemInCount);
-        }
-
-        std::vector<RE::TESBoundObject*> modLists;
-        std::map<RE::TESFile*, std::vector<const QuickArmorRebalance::ArmorSet*>> map;
-
-        for (const auto& i : contents) map[(*i)[0]->GetFile(0)].push_back(i);
-        for (const auto& i : map) {
-            std::vector<RE::TESBoundObject*> sets;
-            for (auto j : i.second)               
-                sets.push_back(BuildArmorSetList(j));
-            modLists.push_back(BuildListFrom(sets, RE::TESLeveledList::kCalculateForEachItemInCount));
-        }
-
-        return BuildListFrom(modLists, RE::TESLeveledList::kCalculateForEachItemInCount);
-
-    }
-
-    template <class T>
-    RE::TESBoundObject* BuildGroupList(const T* contents) {
-        RE::TESBoundObject* lists[3] = {nullptr, nullptr, nullptr};
-
-        int nUsed = 0;
-        for (int i = 0; i < 3; i++) {
-            if ((lists[i] = BuildContentList(contents[i]))) nUsed++;
-        }
-
-        constexpr int weight[] = {15, 4, 1};
-        constexpr int weightTotal = 20;
-
-        if (!nUsed) return nullptr;
-        if (nUsed == 1) {
-            for (int i = 0; i < 3; i++)
-                if (lists[i]) {
-                    if (!g_Config.bEnableRarityNullLoot)
-                        return lists[i];
-                    else
-                        return BuildListFrom(&lists[i], 1, RE::TESLeveledList::kCalculateForEachItemInCount,
-                                             100 - (uint8_t)(100.f * (float)weight[i] / weightTotal));
-                }
-        }
-
-        std::vector<RE::TESBoundObject*> r;
-
-        for (int i = 0; i < 3; i++) {
-            if (lists[i] || g_Config.bEnableRarityNullLoot)
-                for (int n = 0; n < weight[i]; n++) r.push_back(lists[i]);
+            forms.push_back(list);
         }
 
-        return BuildListFrom(r, RE::TESLeveledList::kCalculateForEachItemInCount);
-    }
-
-    int GetGroupEntriesForLevel(int level, QuickArmorRebalance::LootDistGroup* group) {
-        auto r = group->level - level;
-        if (r > group->early) return 0;
-        if (r > 0) return (int)std::round(std::lerp(group->maxw, 1, (float)r / group->early));
-        r += group->peak;
-        if (r >= 0) return group->maxw;
-
-        r += group->falloff;
-        if (r > 0) return (int)std::round(std::lerp(group->minw, group->maxw, (float)r / group->falloff));
-
-        return group->minw;
-    }
-
-    RE::TESForm* BuildCurve(int level,
-                            const std::map<QuickArmorRebalance::LootDistGroup*, RE::TESBoundObject*>& lists) {
-        if (lists.empty()) return nullptr;
-        if (lists.size() == 1) return lists.begin()->second;
-
-        std::vector<RE::TESBoundObject*> entries;
-
-        for (auto& i : lists) {
-            auto n = GetGroupEntriesForLevel(level, i.first);
-            // logger::info("{}[{}]: {}", i.first->name, level, n);
-            while (n-- > 0) entries.push_back(i.second);
-        }
-
-        return BuildListFrom(entries, 0);
-    }
-
-    RE::TESLevItem* BuildCurveList(std::map<QuickArmorRebalance::LootDistGroup*, RE::TESBoundObject*> lists) {
-        if (lists.empty()) return nullptr;
-
-        std::vector<std::pair<uint16_t, RE::TESForm*>> curves;
-
-        int minLevel = 0xffff;
-        int maxLevel = 0;
+        for (const auto& i : plan.fills) {
+            auto list = resolve(i.list);
 
-        for (auto& i : lists) {
-            minLevel = std::min(minLevel, i.first->level - i.first->early);
-            maxLevel = std::max(maxLevel, i.first->level + i.first->peak);
-        }
-
-        minLevel = std::max(minLevel, 1);
-        maxLevel = std::min(maxLevel, 255);
-
-        for (int level = minLevel; level <= maxLevel;
-             level = level < maxLevel ? std::min(level + QuickArmorRebalance::g_Config.levelGranularity, maxLevel) : maxLevel + 1) {
-            auto curve = BuildCurve(level, lists);
-
-            if (curve) curves.push_back({level, curve});
-        }
-
-        auto list = CreateLeveledList();
-        list->llFlags = RE::TESLeveledList::kCalculateForEachItemInCount;
-        list->entries.resize(list->numEntries = (uint8_t)curves.size());
-        for (int i = 0; i < list->numEntries; i++) {
-            auto& e = list->entries[i];
-            e.count = 1;
-            e.form = curves[i].second;
-            e.level = curves[i].first;
-            e.itemExtra = nullptr;
-        }
-
-        return list;
-    }
-
-    void FillContents(const std::map<RE::TESForm*, QuickArmorRebalance::ContainerChance>& containers,
-                      RE::TESLevItem* curveList) {
-        std::map<int, RE::TESBoundObject*> chances;
-
-        for (auto& entry : containers) {
-            if (entry.second.chance <= 0) continue;
-
-            auto list = chances[entry.second.chance];
-            if (!list) {
-                auto chance = std::clamp((int)std::round(entry.second.chance * QuickArmorRebalance::g_Config.fDropRates / 100.0f), 1, 100);
-                if (chance < 100) {
-                    chances[entry.second.chance] = list =
-                        BuildListFrom(&curveList, 1, RE::TESLeveledList::kCalculateForEachItemInCount,
-                                      (int8_t)(100 - entry.second.chance));
-                } else {
-                    chances[entry.second.chance] = list = curveList;  // No reason to make an intermediate table at 100%
-                }
-            }
-
-            if (auto container = entry.first->As<RE::TESContainer>()) {
-                container->AddObjectToContainer(list, entry.second.count, nullptr);
-            } else if (auto llist = entry.first->As<RE::TESLevItem>()) {
+            if (auto container = i.target->As<RE::TESContainer>()) {
+                container->AddObjectToContainer(list, i.count, nullptr);
+            } else if (auto llist = i.target->As<RE::TESLevItem>()) {
                 if (llist->numEntries < kLLMaxSize) {
                     llist->entries.resize(llist->entries.size() + 1);
 
                     auto& e = llist->entries.back();
-                    e.count = (uint16_t)entry.second.count;
+                    e.count = (uint16_t)i.count;
                     e.form = list;
                     e.level = 1;
                     e.itemExtra = nullptr;
@@ -517,43 +313,49 @@ namespace {
         }
     }
 
-    void BuildSetLists() {
-        for (const auto& i : QuickArmorRebalance::g_Data.loot->containerGroups) {
-            auto& group = i.second;
-
-            if (!group.small.empty()) {
-                std::map<QuickArmorRebalance::LootDistGroup*, RE::TESBoundObject*> contentsLists;
-                for (auto& j : group.pieces) {
-                    if (auto list = BuildGroupList(j.second)) contentsLists[j.first] = list;
-                }
-
-                if (auto pieceList = BuildCurveList(std::move(contentsLists))) {
-                    FillContents(group.small, pieceList);
-                }
-            }
-
-            if (!group.large.empty()) {
-                std::map<QuickArmorRebalance::LootDistGroup*, RE::TESBoundObject*> contentsLists;
-                for (auto& j : group.sets) {
-                    if (auto list = BuildGroupList(j.second)) contentsLists[j.first] = list;
-                }
-
-                if (auto pieceList = BuildCurveList(std::move(contentsLists))) {
-                    FillContents(group.large, pieceList);
-                }
-            }
+    void AssignLoot() {
+        auto& loot = *QuickArmorRebalance::g_Data.loot;
 
-            if (!group.weapon.empty()) {
-                std::map<QuickArmorRebalance::LootDistGroup*, RE::TESBoundObject*> contentsLists;
-                for (auto& j : group.weapons) {
-                    if (auto list = BuildGroupList(j.second)) contentsLists[j.first] = list;
-                }
+        std::uint32_t index = 0;
+        for (auto& i : loot.containerGroups) i.second.index = index++;
 
-                if (auto pieceList = BuildCurveList(std::move(contentsLists))) {
-                    FillContents(group.weapon, pieceList);
+        // The arena never gets back what a growing vector lets go of, so size it up front
+        std::size_t n = 0;
+        for (const auto& i : loot.mapItemDist) {
+            n += i.second.profile->containerGroups.size() * ((i.second.piece ? 1 : 0) + (i.second.set.empty() ? 0 : 1));
+        }
+        loot.assignments.reserve(n);
+
+        for (auto& i : loot.mapItemDist) {
+            auto& data = i.second;
+
+            // Slots are read here rather than when the loot was loaded, since changes applied later can remap them
+            data.setPieces.clear();
+            data.setPieces.reserve(data.set.size());
+            for (auto piece : data.set) data.setPieces.push_back({piece, (std::uint32_t)piece->GetSlotMask()});
+
+            for (auto c : data.profile->containerGroups) {
+                if (data.piece) {
+                    auto mod = data.piece->GetFile(0);
+                    if (data.piece->As<RE::TESObjectARMO>())
+                        loot.assignments.push_back({c->index, LootAssignment::Kind::Piece, &c->small, data.group,
+                                                    data.rarity, mod, data.piece, nullptr});
+                    else if (data.piece->As<RE::TESObjectWEAP>())
+                        loot.assignments.push_back({c->index, LootAssignment::Kind::Weapon, &c->weapon, data.group,
+                                                    data.rarity, mod, data.piece, nullptr});
                 }
+                if (!data.set.empty())
+                    loot.assignments.push_back({c->index, LootAssignment::Kind::Set, &c->large, data.group,
+                                                data.rarity, data.set[0]->GetFile(0), nullptr, &data.setPieces});
             }
         }
+
+        // Stable, so items from the same mod keep the order they were loaded in
+        std::stable_sort(loot.assignments.begin(), loot.assignments.end(),
+                         [](const LootAssignment& a, const LootAssignment& b) {
+                             return std::tie(a.containerGroup, a.kind, a.group, a.rarity, a.mod) <
+                                    std::tie(b.containerGroup, b.kind, b.group, b.rarity, b.mod);
+                         });
     }
 }
 
@@ -566,18 +368,37 @@ void QuickArmorRebalance::SetupLootLists() {
 
     logger::info("Processing loot additions");
 
-    for (const auto& i : g_Data.loot->mapItemDist) {
-        auto& data = i.second;
-        for (auto c : data.profile->containerGroups) {
-            if (data.piece) {
-                if (auto armor = data.piece->As<RE::TESObjectARMO>()) c->pieces[data.group][data.rarity].push_back(armor);
-                else if (auto weap = data.piece->As<RE::TESObjectWEAP>())
-                    c->weapons[data.group][data.rarity].push_back(weap);
-            }
-            if (!data.set.empty()) c->sets[data.group][data.rarity].push_back(&data.set);
-        }
+    AssignLoot();
+
+    auto timeStart = std::chrono::steady_clock::now();
+    auto plan = PlanLootLists(g_Data.loot->assignments, {.levelGranularity = g_Config.levelGranularity,
+                                                         .fDropRates = g_Config.fDropRates,
+                                                         .bNormalizeModDrops = g_Config.bNormalizeModDrops,
+                                                         .bEnableRarityNullLoot = g_Config.bEnableRarityNullLoot});
+    auto timePlanned = std::chrono::steady_clock::now();
+
+    if (!ValidateLootPlan(plan)) {
+        logger::error("Loot plan failed its consistency check, no loot lists were added");
+        return;
     }
 
-    BuildSetLists();
+    MaterializeLootPlan(plan);
+    auto timeEnd = std::chrono::steady_clock::now();
+
     logger::info("Done processing loot, {} lists created", g_nLListsCreated);
+    logger::debug("Loot lists planned in {:.1f}ms, created in {:.1f}ms",
+                  std::chrono::duration<float, std::milli>(timePlanned - timeStart).count(),
+                  std::chrono::duration<float, std::milli>(timeEnd - timePlanned).count());
+}
+
+void QuickArmorRebalance::ReleaseLootData() {
+    if (!g_Data.loot) return;
+
+    // The leveled lists only point at forms, so nothing refers back into the build state. What the UI still shows,
+    // the profile and group names, lives in g_Config and g_Data
+    auto bytes = g_Data.loot->heap.GetBytes();
+    auto blocks = g_Data.loot->heap.GetBlocks();
+    g_Data.loot.reset();
+
+    logger::info("Released loot build data: {} KB in {} blocks", (bytes + 1023) / 1024, blocks);
 }
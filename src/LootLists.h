@@ -4,8 +4,9 @@ namespace QuickArmorRebalance {
     using namespace rapidjson;
 
     struct ArmorChangeParams;
+    class NameResolver;
 
-    void LoadLootConfig(const Value& jsonLoot);
+    void LoadLootConfig(const Value& jsonLoot, NameResolver& resolver);
     void ValidateLootConfig();
 
     Value MakeLootChanges(const ArmorChangeParams& params, RE::TESBoundObject* i, MemoryPoolAllocator<>& al);
@@ -13,4 +14,5 @@ namespace QuickArmorRebalance {
     
 
     void SetupLootLists();
+    void ReleaseLootData();  // Frees everything SetupLootLists needed, once the lists have been built
 }
\ No newline at end of file
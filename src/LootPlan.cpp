@@ -0,0 +1,344 @@
+#include "LootPlan.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "Parallel.h"
+
+namespace {
+    using namespace QuickArmorRebalance;
+
+    using Assignments = std::span<const LootAssignment>;
+
+    // End of the run of assignments starting at first that share the same key
+    template <class Key>
+    Assignments::iterator RunEnd(Assignments::iterator first, Assignments::iterator last, Key key) {
+        return std::find_if(first, last,
+                            [&, k = std::invoke(key, *first)](const auto& i) { return std::invoke(key, i) != k; });
+    }
+
+    LootRef Ref(RE::TESBoundObject* form) { return {LootRef::Type::Form, 0, form}; }
+
+    int GetGroupEntriesForLevel(int level, const LootCurve* group) {
+        auto r = group->level - level;
+        if (r > group->early) return 0;
+        if (r > 0) return (int)std::round(std::lerp(group->maxw, 1, (float)r / group->early));
+        r += group->peak;
+        if (r >= 0) return group->maxw;
+
+        r += group->falloff;
+        if (r > 0) return (int)std::round(std::lerp(group->minw, group->maxw, (float)r / group->falloff));
+
+        return group->minw;
+    }
+
+    // The lists planned by one job. List indices are local to it until the fragments are stitched together
+    class Fragment {
+    public:
+        Fragment(const LootPlanSettings& settings, std::span<const LootSet* const> sets)
+            : settings(settings), sets(sets) {}
+
+        std::vector<LootPlan::List> lists;
+        std::vector<LootPlan::Fill> fills;
+
+        LootRef ArmorSetList(const LootSet& set) {
+            std::uint32_t covered = 0;
+            std::vector<LootRef> pieces;
+
+            for (const auto& i : set) {
+                if (covered & i.slots) continue;
+
+                auto slots = i.slots;
+                std::vector<LootRef> conflicts;
+
+                // Two passes - first find potential conflicts, then pick them out
+                // This has to happen just to cover weird situations where pieces overlap inconsistently
+                // Technically would require repeating until it stops changing, but you'd have to design an armor set
+                // just to be obnoxious intentionally
+                for (const auto& j : set)
+                    if (slots & j.slots) slots |= j.slots;
+                for (const auto& j : set)
+                    if (slots & j.slots) conflicts.push_back(Ref(j.item));
+
+                if (conflicts.size() > 1)
+                    pieces.push_back(ListFrom(conflicts, 0));
+                else
+                    pieces.push_back(Ref(i.item));
+
+                covered |= slots;
+            }
+
+            return ListFrom(pieces, LootPlan::List::kUseAll);
+        }
+
+        // One container group's pieces, sets or weapons
+        void PlanContainer(Assignments contents) {
+            const auto& containers = *contents.front().containers;
+            if (containers.empty()) return;
+
+            std::map<const LootCurve*, LootRef> contentsLists;
+            for (auto it = contents.begin(); it != contents.end();) {
+                auto end = RunEnd(it, contents.end(), &LootAssignment::group);
+                if (auto list = GroupList({it, end})) contentsLists[it->group] = list;
+                it = end;
+            }
+
+            if (auto curveList = CurveList(contentsLists)) FillContents(containers, curveList);
+        }
+
+    private:
+        LootRef Add(LootPlan::List list) {
+            lists.push_back(std::move(list));
+            return {LootRef::Type::List, (std::uint32_t)lists.size() - 1};
+        }
+
+        LootRef ListFrom(const LootRef* items, std::size_t count, std::uint8_t flags, std::uint8_t chanceNone = 0) {
+            if (!count) return {};
+            if (count == 1 && !chanceNone) return *items;
+
+            LootPlan::List list{flags, chanceNone};
+            if (count <= kLLMaxSize) {
+                list.entries.reserve(count);
+                for (std::size_t i = 0; i < count; i++) list.entries.push_back({items[i]});
+            } else {
+                // As few sublists as it takes, as even as they can be. Past kLLMaxSize of them, they're split again
+                auto split = std::min(kLLMaxSize, (count + kLLMaxSize - 1) / kLLMaxSize);
+
+                list.entries.reserve(split);
+                for (std::size_t i = 0; i < split; i++) {
+                    auto slice = count / (split - i);
+                    list.entries.push_back({ListFrom(items, slice, flags)});
+
+                    items += slice;
+                    count -= slice;
+                }
+            }
+
+            return Add(std::move(list));
+        }
+
+        LootRef ListFrom(const std::vector<LootRef>& items, std::uint8_t flags) {
+            return ListFrom(items.data(), items.size(), flags);
+        }
+
+        LootRef ContentList(Assignments contents) {
+            auto build = [this](Assignments::iterator first, Assignments::iterator last) {
+                std::vector<LootRef> items;
+                items.reserve(last - first);
+                for (auto it = first; it != last; ++it) {
+                    if (it->set)
+                        items.push_back({LootRef::Type::Set,
+                                         (std::uint32_t)(std::lower_bound(sets.begin(), sets.end(), it->set) -
+                                                         sets.begin())});
+                    else
+                        items.push_back(Ref(it->item));
+                }
+                return ListFrom(items, LootPlan::List::kCalculateForEachItemInCount);
+            };
+
+            if (!settings.bNormalizeModDrops) return build(contents.begin(), contents.end());
+
+            std::vector<LootRef> modLists;
+            for (auto it = contents.begin(); it != contents.end();) {
+                auto end = RunEnd(it, contents.end(), &LootAssignment::mod);
+                modLists.push_back(build(it, end));
+                it = end;
+            }
+
+            return ListFrom(modLists, LootPlan::List::kCalculateForEachItemInCount);
+        }
+
+        // Contents of one dist group, already sorted by rarity
+        LootRef GroupList(Assignments contents) {
+            Assignments byRarity[3];
+            for (auto it = contents.begin(); it != contents.end();) {
+                auto end = RunEnd(it, contents.end(), &LootAssignment::rarity);
+                byRarity[it->rarity] = {it, end};
+                it = end;
+            }
+
+            LootRef rarityLists[3];
+
+            int nUsed = 0;
+            for (int i = 0; i < 3; i++) {
+                if ((rarityLists[i] = ContentList(byRarity[i]))) nUsed++;
+            }
+
+            constexpr int weight[] = {15, 4, 1};
+            constexpr int weightTotal = 20;
+
+            if (!nUsed) return {};
+            if (nUsed == 1) {
+                for (int i = 0; i < 3; i++)
+                    if (rarityLists[i]) {
+                        if (!settings.bEnableRarityNullLoot)
+                            return rarityLists[i];
+                        else
+                            return ListFrom(&rarityLists[i], 1, LootPlan::List::kCalculateForEachItemInCount,
+                                            100 - (std::uint8_t)(100.f * (float)weight[i] / weightTotal));
+                    }
+            }
+
+            std::vector<LootRef> r;
+
+            for (int i = 0; i < 3; i++) {
+                if (rarityLists[i] || settings.bEnableRarityNullLoot)
+                    for (int n = 0; n < weight[i]; n++) r.push_back(rarityLists[i]);
+            }
+
+            return ListFrom(r, LootPlan::List::kCalculateForEachItemInCount);
+        }
+
+        LootRef Curve(int level, const std::map<const LootCurve*, LootRef>& groupLists) {
+            if (groupLists.empty()) return {};
+            if (groupLists.size() == 1) return groupLists.begin()->second;
+
+            std::vector<LootRef> entries;
+
+            for (auto& i : groupLists) {
+                auto n = GetGroupEntriesForLevel(level, i.first);
+                while (n-- > 0) entries.push_back(i.second);
+            }
+
+            return ListFrom(entries, 0);
+        }
+
+        LootRef CurveList(const std::map<const LootCurve*, LootRef>& groupLists) {
+            if (groupLists.empty()) return {};
+
+            int minLevel = 0xffff;
+            int maxLevel = 0;
+
+            for (auto& i : groupLists) {
+                minLevel = std::min(minLevel, i.first->level - i.first->early);
+                maxLevel = std::max(maxLevel, i.first->level + i.first->peak);
+            }
+
+            minLevel = std::max(minLevel, 1);
+            maxLevel = std::min(maxLevel, 255);
+
+            std::vector<LootPlan::Entry> curves;
+            for (int level = minLevel; level <= maxLevel;
+                 level = level < maxLevel ? std::min(level + settings.levelGranularity, maxLevel) : maxLevel + 1) {
+                if (auto curve = Curve(level, groupLists)) curves.push_back({curve, (std::uint16_t)level});
+            }
+
+            return Add({LootPlan::List::kCalculateForEachItemInCount, 0, std::move(curves)});
+        }
+
+        void FillContents(const ContainerList& containers, LootRef curveList) {
+            std::map<int, LootRef> chances;
+
+            for (auto& entry : containers) {
+                if (entry.second.chance <= 0) continue;
+
+                auto& list = chances[entry.second.chance];
+                if (!list) {
+                    auto chance =
+                        std::clamp((int)std::round(entry.second.chance * settings.fDropRates / 100.0f), 1, 100);
+                    if (chance < 100) {
+                        list = ListFrom(&curveList, 1, LootPlan::List::kCalculateForEachItemInCount,
+                                        (std::uint8_t)(100 - entry.second.chance));
+                    } else {
+                        list = curveList;  // No reason to make an intermediate table at 100%
+                    }
+                }
+
+                fills.push_back({entry.first, list, entry.second.count});
+            }
+        }
+
+        const LootPlanSettings& settings;
+        std::span<const LootSet* const> sets;  // Sorted, LootRef::Type::Set indexes into it
+    };
+}
+
+QuickArmorRebalance::LootPlan QuickArmorRebalance::PlanLootLists(std::span<const LootAssignment> assignments,
+                                                                 const LootPlanSettings& settings) {
+    std::vector<Assignments> runs;
+    for (auto it = assignments.begin(); it != assignments.end();) {
+        auto end = RunEnd(it, assignments.end(), &LootAssignment::containers);
+        runs.push_back({it, end});
+        it = end;
+    }
+
+    // A set can go to many container groups but only gets one list, planned once up front. Only sets that end up in
+    // some container get one, or the list would be created with nothing referring to it
+    std::vector<const LootSet*> sets;
+    for (auto run : runs) {
+        if (run.front().containers->empty()) continue;
+        for (const auto& i : run)
+            if (i.set) sets.push_back(i.set);
+    }
+    std::sort(sets.begin(), sets.end());
+    sets.erase(std::unique(sets.begin(), sets.end()), sets.end());
+
+    // The first fragment holds the set lists, the rest one run each
+    std::vector<Fragment> fragments;
+    fragments.reserve(runs.size() + 1);
+    for (std::size_t n = 0; n <= runs.size(); n++) fragments.emplace_back(settings, sets);
+
+    std::vector<LootRef> setLists(sets.size());
+
+    ParallelFor(fragments.size(), [&](std::size_t n) {
+        if (n)
+            fragments[n].PlanContainer(runs[n - 1]);
+        else
+            for (std::size_t i = 0; i < sets.size(); i++) setLists[i] = fragments[0].ArmorSetList(*sets[i]);
+    });
+
+    // Stitch the fragments into one table, in order, so lists still only refer to the ones before them. The set
+    // lists come first, so their indices and setLists are already final
+    LootPlan plan;
+    std::uint32_t base = 0;
+    auto resolve = [&](LootRef ref) {
+        if (ref.type == LootRef::Type::List)
+            ref.index += base;
+        else if (ref.type == LootRef::Type::Set)
+            ref = setLists[ref.index];
+        return ref;
+    };
+
+    for (auto& i : fragments) {
+        for (auto& list : i.lists) {
+            for (auto& e : list.entries) e.ref = resolve(e.ref);
+            plan.lists.push_back(std::move(list));
+        }
+        for (auto& fill : i.fills) {
+            fill.list = resolve(fill.list);
+            plan.fills.push_back(fill);
+        }
+
+        base = (std::uint32_t)plan.lists.size();
+    }
+
+    return plan;
+}
+
+bool QuickArmorRebalance::ValidateLootPlan(const LootPlan& plan) {
+    auto valid = [](const LootRef& ref, std::size_t nLists) {
+        switch (ref.type) {
+            case LootRef::Type::None:
+                return true;
+            case LootRef::Type::Form:
+                return ref.form != nullptr;
+            case LootRef::Type::List:
+                return ref.index < nLists;
+            default:
+                return false;  // Sets are resolved to their lists before the plan is returned
+        }
+    };
+
+    for (std::size_t n = 0; n < plan.lists.size(); n++) {
+        const auto& list = plan.lists[n];
+        if (list.entries.size() > kLLMaxSize) return false;
+        for (const auto& e : list.entries)
+            if (!valid(e.ref, n)) return false;
+    }
+
+    for (const auto& i : plan.fills)
+        if (!i.target || !i.list || !valid(i.list, plan.lists.size())) return false;
+
+    return true;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+// The planner never looks inside a form, so it only needs them declared. That keeps it buildable and testable without
+// the game or CommonLib
+namespace RE {
+    class TESBoundObject;
+    class TESFile;
+    class TESForm;
+}
+
+namespace QuickArmorRebalance {
+    constexpr std::size_t kLLMaxSize = 0xff;  // Not 0x100 because num_entries would roll to 0 at max size
+
+    struct ContainerChance {
+        int count;
+        int chance;
+    };
+
+    using ContainerList = std::pmr::map<RE::TESForm*, ContainerChance>;
+
+    // How many entries a dist group gets in the list for each level
+    struct LootCurve {
+        int level = -1;
+        int early = 0;
+        int peak = 0;
+        int falloff = 0;
+        int minw = 1;
+        int maxw = 5;
+    };
+
+    // A set piece with the slots it covers, read off the armor before planning
+    struct LootSetPiece {
+        RE::TESBoundObject* item;
+        std::uint32_t slots;
+    };
+
+    using LootSet = std::pmr::vector<LootSetPiece>;
+
+    // One piece, weapon or set going into a container group's loot. ModLootData keeps these sorted by container group,
+    // kind, dist group, rarity and mod, so each list that gets built is a contiguous run of them
+    struct LootAssignment
+    {
+        enum class Kind : std::uint8_t
+        {
+            Piece,   // Goes in the group's small containers
+            Set,     // Goes in the large containers
+            Weapon
+        };
+
+        std::uint32_t containerGroup;      // LootContainerGroup::index
+        Kind kind;
+        const ContainerList* containers;  // The group's containers for this kind
+        const LootCurve* group;
+        int rarity;
+        const RE::TESFile* mod;
+
+        RE::TESBoundObject* item;  // Pieces and weapons
+        const LootSet* set;        // Sets
+    };
+
+    // Either an existing form or one of the lists in a LootPlan
+    struct LootRef {
+        enum class Type : std::uint8_t
+        {
+            None,
+            Form,
+            List,
+            Set  // Only while planning, the list of the set at index in the planner's set table
+        };
+
+        Type type = Type::None;
+        std::uint32_t index = 0;
+        RE::TESBoundObject* form = nullptr;
+
+        explicit operator bool() const { return type != Type::None; }
+    };
+
+    // The whole graph of leveled lists the loot build adds, as plain data. Planning only reads the assignments, it
+    // never creates forms, so it can run on any thread
+    struct LootPlan {
+        struct Entry {
+            LootRef ref;
+            std::uint16_t level = 1;
+            std::uint16_t count = 1;
+        };
+
+        struct List {
+            // Same values as RE::TESLeveledList::Flag
+            enum Flag : std::uint8_t
+            {
+                kCalculateForEachItemInCount = 1 << 1,
+                kUseAll = 1 << 2
+            };
+
+            std::uint8_t flags = 0;
+            std::uint8_t chanceNone = 0;
+            std::vector<Entry> entries;
+        };
+
+        // A list to add to a container, or to an existing leveled list
+        struct Fill {
+            RE::TESForm* target;
+            LootRef list;
+            int count;
+        };
+
+        std::vector<List> lists;  // A list only refers to lists before it, so they can be created in order
+        std::vector<Fill> fills;
+    };
+
+    struct LootPlanSettings {
+        int levelGranularity = 3;
+        float fDropRates = 100.0f;
+        bool bNormalizeModDrops = true;
+        bool bEnableRarityNullLoot = false;
+    };
+
+    // Assignments must be sorted the way ModLootData keeps them. Container groups and their pieces, sets and weapons
+    // are planned in parallel, then stitched into one plan
+    LootPlan PlanLootLists(std::span<const LootAssignment> assignments, const LootPlanSettings& settings);
+
+    // Checks what creating the plan relies on: every list fits in a leveled list and only refers to lists before it,
+    // and nothing refers to a set or a list that isn't there
+    bool ValidateLootPlan(const LootPlan& plan);
+}
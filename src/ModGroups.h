@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "FlatMap.h"
+
+namespace QuickArmorRebalance {
+    // Items grouped by the mod they come from, mods in the order they were first seen and items in the order they
+    // were added. Scanning fills one per chunk of a form array, and adding the chunks' groups in chunk order gives
+    // the same groups as one serial scan
+    template <class Mod, class Item>
+    struct ModGroups
+    {
+        void Add(Mod* mod, Item* item) {
+            auto [it, inserted] = index.try_emplace(mod, mods.size());
+            if (inserted) mods.push_back({mod, {}});
+            mods[it->second].second.push_back(item);
+        }
+
+        void Add(const ModGroups& other) {
+            for (const auto& [mod, items] : other.mods)
+                for (auto i : items) Add(mod, i);
+        }
+
+        std::vector<std::pair<Mod*, std::vector<Item*>>> mods;
+        FlatMap<Mod*, std::size_t> index;
+    };
+}
@@ -14,6 +14,8 @@
 
 #include <imgui.h>
 
+#include <memory_resource>
+
 using namespace std::literals;
 
 #define PLUGIN_NAME "QuickArmorRebalance"
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace QuickArmorRebalance {
+    // Calls fn(n) for every n below count, on as many threads as there are cores, the calling thread included. Jobs
+    // are handed out in order from a shared counter, so a few slow ones don't hold up the rest. fn has to be safe to
+    // run for different n at the same time, and results should go to a slot per n to keep the outcome deterministic
+    template <class Fn>
+    void ParallelFor(std::size_t count, const Fn& fn) {
+        if (!count) return;
+
+        std::atomic<std::size_t> next = 0;
+        auto worker = [&]() {
+            for (auto n = next++; n < count; n = next++) fn(n);
+        };
+
+        auto nThreads = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, count);
+        std::vector<std::thread> threads;
+        for (std::size_t n = 1; n < nThreads; n++) threads.emplace_back(worker);
+        worker();
+        for (auto& t : threads) t.join();
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "FlatMap.h"
+
+namespace QuickArmorRebalance {
+    // Every recipe for an item, kept grouped by bench keyword. A recipe is only asked for its benchKeyword, so this
+    // doesn't need the game to build and can be tested with stand-in types
+    template <class Item, class Recipe>
+    struct BasicRecipeIndex
+    {
+        using RecipeList = std::vector<Recipe*>;
+
+        void Add(Item* item, Recipe* recipe) {
+            auto& ls = recipes[item];
+
+            // Insert after the last recipe sharing the bench, so each bench's recipes stay together
+            auto it =
+                std::find_if(ls.rbegin(), ls.rend(), [=](auto i) { return i->benchKeyword == recipe->benchKeyword; });
+            ls.insert(it.base(), recipe);
+        }
+
+        void Remove(Item* item, Recipe* recipe) {
+            auto it = recipes.find(item);
+            if (it == recipes.end()) return;
+            std::erase(it->second, recipe);
+        }
+
+        // Null when the item has no recipes left
+        const RecipeList* Find(Item* item) const {
+            auto it = recipes.find(item);
+            if (it == recipes.end() || it->second.empty()) return nullptr;
+            return &it->second;
+        }
+
+        FlatMap<Item*, RecipeList> recipes;
+    };
+}
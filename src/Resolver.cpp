@@ -0,0 +1,51 @@
+#include "Resolver.h"
+
+#include "Data.h"
+
+const RE::TESFile* QuickArmorRebalance::NameResolver::FindMod(std::string_view name) {
+    nLookups++;
+    if (auto it = mods.find(name); it != mods.end()) {
+        nCached++;
+        return it->second;
+    }
+
+    auto mod = RE::TESDataHandler::GetSingleton()->LookupModByName(name);
+    mods.emplace(Intern(name), mod);
+    return mod;
+}
+
+RE::TESForm* QuickArmorRebalance::NameResolver::FindEditorID(std::string_view edid) {
+    nLookups++;
+    if (auto it = forms.find(edid); it != forms.end()) {
+        nCached++;
+        return it->second;
+    }
+
+    auto form = RE::TESForm::LookupByEditorID(edid);
+    forms.emplace(Intern(edid), form);
+    return form;
+}
+
+RE::TESForm* QuickArmorRebalance::NameResolver::FindIn(const RE::TESFile* mod, const char* str, bool* pOtherFile) {
+    if (!strncmp(str, "0x", 2) || isdigit(*str)) return QuickArmorRebalance::FindIn(mod, str, pOtherFile);
+
+    if (pOtherFile) *pOtherFile = false;
+    if (auto pos = strchr(str, ':')) {
+        if (pOtherFile) *pOtherFile = true;
+        if (auto mod2 = FindMod({str, pos})) return FindIn(mod2, pos + 1);
+        return nullptr;
+    }
+
+    auto r = FindEditorID(str);
+    if (!r || r->GetFile(0) != mod) return nullptr;
+    return r;
+}
+
+bool QuickArmorRebalance::NameResolver::IsFirstMiss(std::string_view what, std::string_view name) {
+    return reported.emplace(std::format("{}\n{}", what, name)).second;
+}
+
+void QuickArmorRebalance::NameResolver::LogStats() const {
+    logger::debug("Resolved {} names with {} lookups, {} from cache, {} not found", strings.size(), nLookups, nCached,
+                  reported.size());
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+namespace QuickArmorRebalance {
+    // Looks up mods and editor IDs while config files are loaded. Every distinct name is interned and only looked
+    // up once, and a name that can't be found is only reported the first time it comes up
+    class NameResolver {
+    public:
+        const RE::TESFile* FindMod(std::string_view name);
+        RE::TESForm* FindEditorID(std::string_view edid);
+
+        // Same rules as the FindIn in Data.h: hex or decimal ids are local to the mod, "Mod.esp:..." looks in another
+        // mod, and editor IDs only count when the form comes from the mod
+        RE::TESForm* FindIn(const RE::TESFile* mod, const char* str, bool* pOtherFile = nullptr);
+
+        // Resolves a whole list of editor IDs, reporting any that are missing or the wrong type
+        template <class T>
+        std::vector<T*> FindAll(std::span<const std::string_view> edids, std::string_view what) {
+            std::vector<T*> r;
+            r.reserve(edids.size());
+            for (auto i : edids) {
+                auto form = FindEditorID(i);
+                if (auto t = form ? form->As<T>() : nullptr)
+                    r.push_back(t);
+                else if (IsFirstMiss(what, i))
+                    logger::info("{} not found: {}", what, i);
+            }
+            return r;
+        }
+
+        // True only the first time a name is missed, so callers log each one once
+        bool IsFirstMiss(std::string_view what, std::string_view name);
+
+        void LogStats() const;
+
+    private:
+        std::string_view Intern(std::string_view str) { return *strings.emplace(str).first; }
+
+        std::unordered_set<std::string> strings;  // Node based, so views into it stay valid
+        std::unordered_map<std::string_view, const RE::TESFile*> mods;
+        std::unordered_map<std::string_view, RE::TESForm*> forms;
+        std::unordered_set<std::string> reported;
+
+        std::size_t nLookups = 0;
+        std::size_t nCached = 0;
+    };
+}
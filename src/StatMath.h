@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// The stat math for one changed field, given the source stat already multiplied by the change's scale. Only armor
+// changes carry a relative weight, it is always 1 for weapons and ammo. Nothing here reads the forms or the config, so
+// it's tested on its own
+
+namespace QuickArmorRebalance {
+    inline int ScaleArmorStat(float w, float f) { return std::max(1, (int)(w * f)); }
+
+    inline float ScaleWeight(float w, float f, bool bRound) {
+        f *= w;
+        if (bRound) f = std::max(0.1f, 0.1f * std::round(10.0f * f));
+        return f;
+    }
+
+    inline std::uint16_t ScaleWeapDamage(float f) { return (std::uint16_t)std::max(1, (int)f); }
+    inline float ScaleAmmoDamage(float f) { return std::max(1.0f, f); }
+
+    // Stat changes for many items at once: the source stats, scales and weights are gathered into one column per
+    // field, each column is computed in a single branch-free pass, then the results are read back per row
+    class StatColumns
+    {
+    public:
+        enum Field { kArmorRating, kWeapDamage, kCritDamage, kAmmoDamage, kWeight, kSpeed, kStagger, kValue, kFields };
+
+        std::size_t size() const { return changed.size(); }
+
+        // Adds a row that changes nothing, returning its index. The columns only grow as rows set them, an armor row
+        // leaves the weapon columns alone until Compute fills them out
+        std::size_t AddRow() {
+            changed.push_back(0);
+            return changed.size() - 1;
+        }
+
+        void Set(std::size_t r, Field f, float src, float scale, float w) {
+            auto& c = columns[f];
+            if (c.src.size() <= r) c.Resize(std::max<std::size_t>(2 * c.src.size(), r + 1));
+            c.src[r] = src;
+            c.scale[r] = scale;
+            c.w[r] = w;
+            changed[r] |= 1 << f;
+        }
+
+        // The row is kept, but changes nothing
+        void Unset(std::size_t r) { changed[r] = 0; }
+
+        void Compute(bool bRoundWeight) {
+            for (auto& c : columns)
+                if (!c.src.empty()) c.Resize(size());
+            Run(kArmorRating, [](float w, float f) { return (float)ScaleArmorStat(w, f); });
+            Run(kWeapDamage, [](float, float f) { return (float)ScaleWeapDamage(f); });
+            Run(kCritDamage, [](float, float f) { return (float)ScaleWeapDamage(f); });
+            Run(kAmmoDamage, [](float, float f) { return ScaleAmmoDamage(f); });
+            Run(kWeight, [=](float w, float f) { return ScaleWeight(w, f, bRoundWeight); });
+            Run(kSpeed, [](float, float f) { return f; });
+            Run(kStagger, [](float, float f) { return f; });
+            Run(kValue, [](float w, float f) { return (float)ScaleArmorStat(w, f); });
+        }
+
+        std::optional<float> Get(std::size_t r, Field f) const {
+            if (!(changed[r] & (1 << f))) return std::nullopt;
+            return columns[f].out[r];
+        }
+
+        void Clear() {
+            changed.clear();
+            for (auto& c : columns) {
+                c.src.clear();
+                c.scale.clear();
+                c.w.clear();
+                c.out.clear();
+            }
+        }
+
+    private:
+        struct Column {
+            std::vector<float> src;
+            std::vector<float> scale;
+            std::vector<float> w;
+            std::vector<float> out;
+
+            // Rows that don't set the field read as unchanged: no source, no scale
+            void Resize(std::size_t n) {
+                src.resize(n, 0.0f);
+                scale.resize(n, 0.0f);
+                w.resize(n, 1.0f);
+            }
+        };
+
+        // A zero source or a non-positive scale zeroes the field, same as the game data would have it. Columns no row
+        // set are skipped
+        void Run(Field f, const auto& op) {
+            auto& c = columns[f];
+            auto n = c.src.size();
+            c.out.resize(n);
+
+            const float* src = c.src.data();
+            const float* scale = c.scale.data();
+            const float* w = c.w.data();
+            float* __restrict out = c.out.data();
+            for (std::size_t i = 0; i < n; i++) {
+                float v = op(w[i], scale[i] * src[i]);
+                out[i] = (src[i] != 0.0f) & (scale[i] > 0.0f) ? v : 0.0f;
+            }
+        }
+
+        Column columns[kFields];
+        std::vector<std::uint8_t> changed;  // Bit per field that the row's change sets
+    };
+}
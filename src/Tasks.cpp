@@ -0,0 +1,58 @@
+#include "Tasks.h"
+
+#include <thread>
+
+namespace {
+    using namespace QuickArmorRebalance;
+
+    std::unique_ptr<Task> g_task;
+    float g_taskBudget = kTaskFrameBudgetMs;
+}
+
+void QuickArmorRebalance::StartTask(std::unique_ptr<Task> task, float msBudget) {
+    if (g_task) {
+        logger::warn("Task {} started while {} was still running, cancelling it", task->GetName(), g_task->GetName());
+        CancelTask();
+    }
+
+    logger::debug("Starting task {}", task->GetName());
+    g_task = std::move(task);
+    g_taskBudget = msBudget;
+}
+
+bool QuickArmorRebalance::IsTaskRunning() { return g_task != nullptr; }
+
+const QuickArmorRebalance::Task* QuickArmorRebalance::GetCurrentTask() { return g_task.get(); }
+
+void QuickArmorRebalance::CancelTask() {
+    if (!g_task) return;
+
+    logger::info("Task {} cancelled at {:.0f}%", g_task->GetName(), 100.0f * g_task->GetProgress());
+    g_task->Cancel();
+    g_task.reset();
+}
+
+void QuickArmorRebalance::RunTasks() {
+    if (!g_task) return;
+
+    // Always make at least one step of progress, even if the frame budget is tiny
+    auto timeEnd = std::chrono::steady_clock::now() + std::chrono::duration<float, std::milli>(g_taskBudget);
+    do {
+        switch (g_task->Step()) {
+            case Task::StepResult::kContinue:
+                break;
+            case Task::StepResult::kYield:
+                return;
+            case Task::StepResult::kDone:
+                logger::debug("Task {} complete", g_task->GetName());
+                g_task.reset();
+                return;
+        }
+    } while (std::chrono::steady_clock::now() < timeEnd);
+}
+
+void QuickArmorRebalance::RunTaskNow(Task& task) {
+    for (auto r = task.Step(); r != Task::StepResult::kDone; r = task.Step()) {
+        if (r == Task::StepResult::kYield) std::this_thread::yield();
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+namespace QuickArmorRebalance {
+    constexpr float kTaskFrameBudgetMs = 4.0f;
+
+    // Long running work that is advanced a small step at a time from the render loop, so a large job is spread
+    // over many frames instead of stalling one
+    class Task {
+    public:
+        virtual ~Task() = default;
+
+        virtual const char* GetName() const = 0;
+
+        enum class StepResult {
+            kContinue,  // More to do, can be called again this frame
+            kYield,     // Waiting on something else, try again next frame
+            kDone
+        };
+
+        // Does a small, bounded amount of work
+        virtual StepResult Step() = 0;
+        virtual float GetProgress() const = 0;
+
+        // Stop early, leaving things in a consistent state. Step is not called again afterwards
+        virtual void Cancel() {}
+    };
+
+    void StartTask(std::unique_ptr<Task> task, float msBudget = kTaskFrameBudgetMs);
+    bool IsTaskRunning();
+    const Task* GetCurrentTask();
+    void CancelTask();
+
+    // Runs the current task until it finishes or its time budget for this frame is used up
+    void RunTasks();
+
+    // Runs a task to completion immediately
+    void RunTaskNow(Task& task);
+}
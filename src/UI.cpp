@@ -5,6 +5,7 @@
 #include "Config.h"
 #include "Data.h"
 #include "ImGuiIntegration.h"
+#include "Tasks.h"
 
 using namespace QuickArmorRebalance;
 
@@ -38,6 +39,65 @@ void MakeTooltip(const char* str, bool delay = false) {
         ImGui::SetTooltip(str);
 }
 
+// Original values next to the live ones, for whatever QAR changed on the item
+std::string DescribeChanges(RE::TESBoundObject* item) {
+    const auto& a = g_Data.originals;
+    auto r = a.Find(item);
+    if (r == OriginalsArena::kNone) return "No original values recorded";
+
+    std::string str;
+    auto add = [&](const char* field, auto before, auto after) {
+        if (before != after) str += std::format("{}: {} -> {}\n", field, before, after);
+    };
+
+    if (auto armor = item->As<RE::TESObjectARMO>()) {
+        add("Armor", a.rating[r] / 100.0f, armor->armorRating / 100.0f);
+        add("Weight", a.weight[r], armor->weight);
+        add("Value", a.value[r], armor->value);
+        if (a.armorType[r] != armor->bipedModelData.armorType.underlying()) str += "Armor type changed\n";
+    } else if (auto weap = item->As<RE::TESObjectWEAP>()) {
+        add("Damage", a.rating[r], (std::uint32_t)weap->attackDamage);
+        add("Crit damage", a.damage[r], (float)weap->criticalData.damage);
+        add("Crit multiplier", a.critMult[r], weap->criticalData.prcntMult);
+        add("Speed", a.speed[r], weap->weaponData.speed);
+        add("Stagger", a.stagger[r], weap->weaponData.staggerValue);
+        add("Weight", a.weight[r], weap->weight);
+        add("Value", a.value[r], weap->value);
+    } else if (auto ammo = item->As<RE::TESAmmo>()) {
+        add("Damage", a.damage[r], ammo->GetRuntimeData().data.damage);
+        add("Value", a.value[r], ammo->value);
+    }
+
+    if (str.empty()) str = "No stat changes";
+    else str.pop_back();
+    return str;
+}
+
+std::string DescribePreview(const ItemPreview& p) {
+    std::string str;
+    auto add = [&](const char* field, auto before, auto after) {
+        if (before != after) str += std::format("{}: {} -> {}\n", field, before, after);
+    };
+    auto addRecipe = [&](const char* field, int before, int after) {
+        auto cost = [](int n) { return n < 0 ? std::string("none") : std::format("{} materials", n); };
+        if (before != after) str += std::format("{}: {} -> {}\n", field, cost(before), cost(after));
+    };
+
+    const auto& b = p.before;
+    const auto& a = p.after;
+    add(p.item->As<RE::TESObjectARMO>() ? "Armor" : "Damage", b.rating, a.rating);
+    add("Weight", b.weight, a.weight);
+    add("Speed", b.speed, a.speed);
+    add("Stagger", b.stagger, a.stagger);
+    add("Value", b.value, a.value);
+    addRecipe("Temper", b.temperCost, a.temperCost);
+    addRecipe("Craft", b.craftCost, a.craftCost);
+
+    if (str.empty()) str = "No stat changes";
+    else str.pop_back();
+    return str;
+}
+
 struct ItemFilter {
     char nameFilter[200]{""};
 
@@ -53,7 +113,7 @@ struct ItemFilter {
     bool bFilterChanged = true;
     bool bUnmodified = false;
 
-    bool Pass(RE::TESBoundObject* obj) const {
+    bool Pass(RE::TESBoundObject* obj, ItemStates::Ordinal o) const {
         // Run these fastest to slowest
         if (nType) {
             switch (nType) {
@@ -73,27 +133,62 @@ struct ItemFilter {
 
         if (slots) {
             if (auto armor = obj->As<RE::TESObjectARMO>()) {
-                auto s = MapFindOr(g_Data.modifiedArmorSlots, armor, (ArmorSlots)armor->GetSlotMask());
-                switch (slotMode) {
-                    case SlotsAny:
-                        if ((s & slots) == 0) return false;
-                        break;
-                    case SlotsAll:
-                        if ((s & slots) != slots) return false;
-                        break;
-                    case SlotsNot:
-                        if ((s & slots) != 0) return false;
-                        break;
-                }
+                if (!PassSlots(g_Data.itemStates.GetOriginalSlots(o, (ArmorSlots)armor->GetSlotMask()))) return false;
             } else
                 return false;
         }
 
-        if (bUnmodified && (g_Data.modifiedItems.contains(obj) || g_Data.modifiedItemsShared.contains(obj)))
-            return false;
+        return PassModified(o);
+    }
 
+    bool PassSlots(ArmorSlots s) const {
+        switch (slotMode) {
+            case SlotsAny:
+                return (s & slots) != 0;
+            case SlotsAll:
+                return (s & slots) == slots;
+            case SlotsNot:
+                return (s & slots) == 0;
+        }
         return true;
     }
+
+    bool PassModified(ItemStates::Ordinal o) const {
+        return !bUnmodified || !(g_Data.itemStates.Get(o) & (ItemStates::kModified | ItemStates::kModifiedShared));
+    }
+
+    // Same as Pass, for a mod's pre-sorted item ranges where the type is known and slots come from the column
+    void AddModItems(const ModData* mod, std::vector<RE::TESBoundObject*>& out,
+                     std::vector<ItemStates::Ordinal>& outOrdinals) const {
+        static constexpr ModData::ItemType kTypes[] = {ModData::kArmor, ModData::kWeapon, ModData::kAmmo};
+
+        auto cmp = [=](std::uint32_t a, std::uint32_t b) {
+            return _stricmp(mod->items[a]->GetName(), mod->items[b]->GetName()) < 0;
+        };
+
+        std::vector<std::uint32_t> passed;
+        for (auto type : kTypes) {
+            if (nType && nType != type + 1) continue;
+            if (slots && type != ModData::kArmor) continue;
+
+            auto segStart = passed.size();
+            for (auto n = mod->typeStart[type]; n < mod->typeStart[type + 1]; n++) {
+                if (slots && !PassSlots(mod->slots[n])) continue;
+                if (*nameFilter && !StringContainsI(mod->items[n]->GetName(), nameFilter)) continue;
+                if (!PassModified(mod->ordinals[n])) continue;
+                passed.push_back(n);
+            }
+
+            // Each range is already in name order, so combining them is a merge rather than a sort
+            if (segStart && segStart != passed.size())
+                std::inplace_merge(passed.begin(), passed.begin() + segStart, passed.end(), cmp);
+        }
+
+        for (auto n : passed) {
+            out.push_back(mod->items[n]);
+            outOrdinals.push_back(mod->ordinals[n]);
+        }
+    }
 };
 
 void RightAlign(const char* text) {
@@ -300,13 +395,14 @@ void PermissionsChecklist(const char* id, Permissions& p) {
 
 enum { ModSpecial_Worn, ModSpecial_All };
 
-void AddFormsToList(const auto& all, const ItemFilter& filter) {
-    ArmorChangeParams& params = g_Config.acParams;
+void AddFormsToList(const auto& all, const ItemFilter& filter,
+                    std::vector<std::pair<RE::TESBoundObject*, ItemStates::Ordinal>>& out) {
     for (auto i : all) {
-        if (!IsValidItem(i)) continue;
-        if (!filter.Pass(i)) continue;
+        auto o = g_Data.itemStates.Track(i);
+        if (!IsValidItem(o)) continue;
+        if (!filter.Pass(i, o)) continue;
 
-        if (params.filteredItems.size() < kItemListLimit) params.filteredItems.push_back(i);
+        if (out.size() < kItemListLimit) out.push_back({i, o});
     }
 }
 
@@ -319,40 +415,45 @@ void GetCurrentListItems(ModData* curMod, int nModSpecial, const ItemFilter& fil
 
     ArmorChangeParams& params = g_Config.acParams;
     params.filteredItems.clear();
+    params.filteredOrdinals.clear();
     if (curMod) {
-        for (auto i : curMod->items) {
-            if (!filter.Pass(i)) continue;
-
-            params.filteredItems.push_back(i);
-        }
+        // Mod items are stored in display order, so no sort is needed afterwards
+        filter.AddModItems(curMod, params.filteredItems, params.filteredOrdinals);
     } else {
+        // Ordinals are looked up once here, so nothing that runs per row per frame needs to
+        std::vector<std::pair<RE::TESBoundObject*, ItemStates::Ordinal>> items;
         switch (nModSpecial) {
             case ModSpecial_Worn:
                 if (auto player = RE::PlayerCharacter::GetSingleton()) {
                     for (auto& item : player->GetInventory()) {
                         if (item.second.second->IsWorn()) {
-                            if (!IsValidItem(item.first)) continue;
-                            if (!filter.Pass(item.first)) continue;
+                            auto o = g_Data.itemStates.Track(item.first);
+                            if (!IsValidItem(o)) continue;
+                            if (!filter.Pass(item.first, o)) continue;
 
-                            params.filteredItems.push_back(item.first);
+                            items.push_back({item.first, o});
                         }
                     }
                 }
                 break;
             case ModSpecial_All:
                 auto dh = RE::TESDataHandler::GetSingleton();
-                AddFormsToList(dh->GetFormArray<RE::TESObjectARMO>(), filter);
-                AddFormsToList(dh->GetFormArray<RE::TESObjectWEAP>(), filter);
-                AddFormsToList(dh->GetFormArray<RE::TESAmmo>(), filter);
+                AddFormsToList(dh->GetFormArray<RE::TESObjectARMO>(), filter, items);
+                AddFormsToList(dh->GetFormArray<RE::TESObjectWEAP>(), filter, items);
+                AddFormsToList(dh->GetFormArray<RE::TESAmmo>(), filter, items);
                 break;
         }
-    }
 
-    if (!params.filteredItems.empty()) {
-        std::sort(params.filteredItems.begin(), params.filteredItems.end(),
-                  [](RE::TESBoundObject* const a, RE::TESBoundObject* const b) {
-                      return _stricmp(a->GetName(), b->GetName()) < 0;
-                  });
+        std::sort(items.begin(), items.end(), [](const auto& a, const auto& b) {
+            return _stricmp(a.first->GetName(), b.first->GetName()) < 0;
+        });
+
+        params.filteredItems.reserve(items.size());
+        params.filteredOrdinals.reserve(items.size());
+        for (const auto& i : items) {
+            params.filteredItems.push_back(i.first);
+            params.filteredOrdinals.push_back(i.second);
+        }
     }
 }
 
@@ -399,6 +500,21 @@ struct HighlightTrack {
     }
 };
 
+void RenderTaskProgress() {
+    auto task = GetCurrentTask();
+    if (!task) return;
+
+    ImGui::SetNextWindowSizeConstraints({700, 250}, {1600, 1000});
+    if (ImGui::Begin("Quick Armor Rebalance", nullptr, ImGuiWindowFlags_NoScrollbar)) {
+        ImGui::Text("%s...", task->GetName());
+        ImGui::ProgressBar(task->GetProgress(), {-FLT_MIN, 0});
+        if (ImGui::Button("Cancel")) CancelTask();
+    }
+
+    ImGuiIntegration::BlockInput(!ImGui::IsWindowCollapsed(), ImGui::IsItemHovered());
+    ImGui::End();
+}
+
 void QuickArmorRebalance::RenderUI() {
     const auto colorChanged = IM_COL32(0, 255, 0, 255);
     const auto colorChangedShared = IM_COL32(255, 255, 0, 255);
@@ -408,11 +524,11 @@ void QuickArmorRebalance::RenderUI() {
     const char* itemTypes[] = {"Any", "Armor", "Weapons", "Ammo", nullptr};
 
     bool isActive = true;
-    static std::set<RE::TESBoundObject*> selectedItems;
+    static ItemFlagSet selectedItems{g_Data.itemStates, ItemStates::kSelected};
     static RE::TESBoundObject* lastSelectedItem = nullptr;
     static GivenItems givenItems;
     static ModData* curMod = nullptr;
-    static std::set<RE::TESObject*> uncheckedItems;
+    static ItemFlagSet uncheckedItems{g_Data.itemStates, ItemStates::kUnchecked};
 
     if (!RE::UI::GetSingleton()->numPausesGame) givenItems.recentEquipSlots = 0;
 
@@ -442,6 +558,13 @@ void QuickArmorRebalance::RenderUI() {
         remappedTar |= i.second < 32 ? (1 << i.second) : 0;
     }
 
+    // The rest of the UI is held back while a task runs, since it edits the state the task is working from. The task
+    // itself is advanced every frame from the present hook
+    if (IsTaskRunning()) {
+        RenderTaskProgress();
+        return;
+    }
+
     ImGuiWindowFlags wndFlags = ImGuiWindowFlags_NoScrollbar;
     if (bMenuHovered) wndFlags |= ImGuiWindowFlags_MenuBar;
 
@@ -530,10 +653,7 @@ void QuickArmorRebalance::RenderUI() {
                                 int pop = 0;
                                 if (g_Data.modifiedFiles.contains(i->mod)) {
                                     if (bFilterChangedMods) continue;
-                                    if (g_Data.modifiedFilesDeleted.contains(i->mod))
-                                        ImGui::PushStyleColor(ImGuiCol_Text, colorDeleted);
-                                    else
-                                        ImGui::PushStyleColor(ImGuiCol_Text, colorChanged);
+                                    ImGui::PushStyleColor(ImGuiCol_Text, colorChanged);
                                     pop++;
                                 } else if (g_Data.modifiedFilesShared.contains(i->mod)) {
                                     if (bFilterChangedMods) continue;
@@ -547,6 +667,7 @@ void QuickArmorRebalance::RenderUI() {
                                     }
 
                                     curMod = i;
+                                    curMod->EnsurePopulated();
                                     givenItems.items.clear();
                                     selectedItems.clear();
                                     lastSelectedItem = nullptr;
@@ -591,7 +712,8 @@ void QuickArmorRebalance::RenderUI() {
 
                             if (ImGui::BeginPopupModal(popupTitle, NULL, ImGuiWindowFlags_AlwaysAutoResize)) {
                                 ImGui::Text("Delete all changes to %s?", curMod->mod->fileName);
-                                ImGui::Text("Changes will not revert until after restarting Skyrim");
+                                ImGui::Text("Items are reverted immediately, shared changes are kept");
+                                ImGui::Text("Loot lists they were added to keep them until the game is restarted");
 
                                 if (ImGui::Button("Delete changes", ImVec2(120, 0))) {
                                     DeleteAllChanges(curMod->mod);
@@ -770,7 +892,7 @@ void QuickArmorRebalance::RenderUI() {
                         ImGui::EndTable();
 
                         if (bApply) {
-                            MakeArmorChanges(params);
+                            if (auto task = MakeArmorChangesTask(params)) StartTask(std::move(task));
 
                             if (g_Config.bAutoDeleteGiven) givenItems.Remove();
 
@@ -792,14 +914,14 @@ void QuickArmorRebalance::RenderUI() {
                     bool hasEnabledWeap = false;
 
                     if (params.filteredItems.size() < kItemListLimit) {
-                        for (auto i : params.filteredItems) {
-                            if (i->As<RE::TESObjectARMO>()) {
-                                if (!uncheckedItems.contains(i)) hasEnabledArmor = true;
-                            } else if (i->As<RE::TESObjectWEAP>()) {
-                                if (!uncheckedItems.contains(i)) hasEnabledWeap = true;
-                            } else if (i->As<RE::TESAmmo>()) {
-                                if (!uncheckedItems.contains(i)) hasEnabledWeap = true;
-                            }
+                        for (std::size_t n = 0; n < params.filteredItems.size(); n++) {
+                            if (uncheckedItems.contains(params.filteredOrdinals[n])) continue;
+
+                            auto i = params.filteredItems[n];
+                            if (i->As<RE::TESObjectARMO>())
+                                hasEnabledArmor = true;
+                            else if (i->As<RE::TESObjectWEAP>() || i->As<RE::TESAmmo>())
+                                hasEnabledWeap = true;
                         }
                     }
 
@@ -818,11 +940,13 @@ void QuickArmorRebalance::RenderUI() {
 
                     hlDistributeAs.Push(params.bDistribute);
 
-                    if (ImGui::BeginCombo("##DistributeAs", params.distProfile,
+                    const char* profileName =
+                        params.distProfile != kNoName ? g_Data.names.GetName(params.distProfile).c_str() : "";
+                    if (ImGui::BeginCombo("##DistributeAs", profileName,
                                           ImGuiComboFlags_PopupAlignLeft | ImGuiComboFlags_HeightLarge)) {
-                        for (auto& i : g_Config.lootProfiles) {
+                        for (auto i : g_Config.lootProfiles) {
                             bool selected = params.distProfile == i;
-                            if (ImGui::Selectable(i.c_str(), selected)) params.distProfile = i.c_str();
+                            if (ImGui::Selectable(g_Data.names.GetName(i).c_str(), selected)) params.distProfile = i;
                             if (selected) ImGui::SetItemDefaultFocus();
                         }
 
@@ -907,15 +1031,20 @@ void QuickArmorRebalance::RenderUI() {
                                 ImGui::Text("Stat distribution curve");
                                 ImGui::SameLine();
 
-                                static auto* curCurve = &g_Config.curves[0];
+                                // Found from the params each frame, a held pointer would go stale on config reload
+                                auto* curCurve = &g_Config.curves[0];
+                                for (auto& i : g_Config.curves) {
+                                    if (&i.second == params.curve) curCurve = &i;
+                                }
 
                                 ImGui::SetNextItemWidth(220);
-                                if (ImGui::BeginCombo("##Curve", curCurve->first.c_str(),
+                                if (ImGui::BeginCombo("##Curve", g_Data.names.GetName(curCurve->first).c_str(),
                                                       ImGuiComboFlags_PopupAlignLeft | ImGuiComboFlags_HeightLarge)) {
                                     for (auto& i : g_Config.curves) {
                                         bool selected = curCurve == &i;
-                                        ImGui::PushID(i.first.c_str());
-                                        if (ImGui::Selectable(i.first.c_str(), selected)) curCurve = &i;
+                                        ImGui::PushID((int)i.first);
+                                        if (ImGui::Selectable(g_Data.names.GetName(i.first).c_str(), selected))
+                                            curCurve = &i;
                                         if (selected) ImGui::SetItemDefaultFocus();
                                         ImGui::PopID();
                                     }
@@ -1027,9 +1156,9 @@ void QuickArmorRebalance::RenderUI() {
                     auto player = RE::PlayerCharacter::GetSingleton();
 
                     params.items.clear();
+                    params.itemSlots.clear();
                     params.items.reserve(params.filteredItems.size());
-
-                    bool modChangesDeleted = g_Data.modifiedFilesDeleted.contains(curMod->mod);
+                    params.itemSlots.reserve(params.filteredItems.size());
 
                     ImGui::PushStyleColor(ImGuiCol_NavHighlight, IM_COL32(0, 255, 0, 255));
 
@@ -1059,7 +1188,8 @@ void QuickArmorRebalance::RenderUI() {
                                 }
                                 if (ImGui::Selectable("Enable ONLY")) {
                                     uncheckedItems.clear();
-                                    uncheckedItems.insert(params.filteredItems.begin(), params.filteredItems.end());
+                                    uncheckedItems.insert(params.filteredOrdinals.begin(),
+                                                          params.filteredOrdinals.end());
                                     for (auto i : selectedItems) uncheckedItems.erase(i);
                                 }
                                 if (ImGui::Selectable("Disable")) {
@@ -1096,29 +1226,37 @@ void QuickArmorRebalance::RenderUI() {
                             ImGui::Separator();
                             if (ImGui::Selectable("Enable all")) uncheckedItems.clear();
                             if (ImGui::Selectable("Disable all"))
-                                for (auto i : params.filteredItems) uncheckedItems.insert(i);
+                                uncheckedItems.insert(params.filteredOrdinals.begin(), params.filteredOrdinals.end());
 
                             ImGui::EndPopup();
                         }
 
+                        RE::TESBoundObject* hoveredItem = nullptr;
+
                         // Clear out selections that are no longer visible
-                        auto lastSelected(std::move(selectedItems));
+                        std::vector<ItemStates::Ordinal> visibleSelected;
                         bool hasAnchor = false;
-                        for (auto i : params.filteredItems) {
-                            if (lastSelected.contains(i)) selectedItems.insert(i);
-                            if (i == lastSelectedItem) hasAnchor = true;
+                        for (std::size_t n = 0; n < params.filteredItems.size(); n++) {
+                            auto o = params.filteredOrdinals[n];
+                            if (selectedItems.contains(o)) visibleSelected.push_back(o);
+                            if (params.filteredItems[n] == lastSelectedItem) hasAnchor = true;
+                        }
+                        if (visibleSelected.size() != selectedItems.size()) {
+                            selectedItems.clear();
+                            selectedItems.insert(visibleSelected.begin(), visibleSelected.end());
                         }
                         if (!hasAnchor) lastSelectedItem = nullptr;
 
-                        for (auto i : params.filteredItems) {
+                        for (std::size_t row = 0; row < params.filteredItems.size(); row++) {
+                            auto i = params.filteredItems[row];
+                            auto o = params.filteredOrdinals[row];
+                            const auto itemFlags = g_Data.itemStates.Get(o);
+
                             int popCol = 0;
-                            if (g_Data.modifiedItems.contains(i)) {
-                                if (modChangesDeleted)
-                                    ImGui::PushStyleColor(ImGuiCol_Text, colorDeleted);
-                                else
-                                    ImGui::PushStyleColor(ImGuiCol_Text, colorChanged);
+                            if (itemFlags & ItemStates::kModified) {
+                                ImGui::PushStyleColor(ImGuiCol_Text, colorChanged);
                                 popCol++;
-                            } else if (g_Data.modifiedItemsShared.contains(i)) {
+                            } else if (itemFlags & ItemStates::kModifiedShared) {
                                 ImGui::PushStyleColor(ImGuiCol_Text, colorChangedShared);
                                 popCol++;
                             } else if (!WillBeModified(i, remappedSrc)) {
@@ -1134,16 +1272,22 @@ void QuickArmorRebalance::RenderUI() {
 
                             ImGui::BeginGroup();
 
-                            bool isChecked = !uncheckedItems.contains(i);
+                            bool isChecked = !(itemFlags & ItemStates::kUnchecked);
                             ImGui::PushID(name.c_str());
 
                             if (ImGui::Checkbox("##ItemCheckbox", &isChecked)) {
                                 if (!isChecked)
-                                    uncheckedItems.insert(i);
+                                    uncheckedItems.insert(o);
                                 else
-                                    uncheckedItems.erase(i);
+                                    uncheckedItems.erase(o);
+                            }
+                            if (isChecked) {
+                                ArmorSlots slots = 0;
+                                if (auto armor = i->As<RE::TESObjectARMO>())
+                                    slots = g_Data.itemStates.GetOriginalSlots(o, (ArmorSlots)armor->GetSlotMask());
+                                params.items.push_back(i);
+                                params.itemSlots.push_back(slots);
                             }
-                            if (isChecked) params.items.push_back(i);
 
                             ImGui::SameLine();
 
@@ -1156,7 +1300,7 @@ void QuickArmorRebalance::RenderUI() {
                                 popCol++;
                             }
 
-                            bool selected = selectedItems.contains(i);
+                            bool selected = (itemFlags & ItemStates::kSelected) != 0;
 
                             if (i == keyboardNav) {
                                 ImGui::SetKeyboardFocusHere();  // This will cause a frame of jitter if the name is too
@@ -1193,12 +1337,12 @@ void QuickArmorRebalance::RenderUI() {
                                     if (!isShiftDown) {
                                         lastSelectedItem = i;
                                         if (selected)
-                                            selectedItems.insert(i);
+                                            selectedItems.insert(o);
                                         else
-                                            selectedItems.erase(i);
+                                            selectedItems.erase(o);
                                     } else {
                                         if (lastSelectedItem == i)
-                                            selectedItems.insert(i);
+                                            selectedItems.insert(o);
                                         else if (lastSelectedItem) {
                                             bool adding = false;
                                             for (auto j : params.filteredItems) {
@@ -1217,6 +1361,8 @@ void QuickArmorRebalance::RenderUI() {
                                 }
                             }
 
+                            if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) hoveredItem = i;
+
                             if (ImGui::IsItemFocused()) {
                                 ImGui::SetScrollFromPosX(
                                     xPos - ImGui::GetCursorPosX(),
@@ -1305,10 +1451,10 @@ void QuickArmorRebalance::RenderUI() {
                                         }
                                     } else {
                                         lastSelectedItem = i;
-                                        if (selectedItems.contains(i))
-                                            selectedItems.erase(i);
+                                        if (selectedItems.contains(o))
+                                            selectedItems.erase(o);
                                         else
-                                            selectedItems.insert(i);
+                                            selectedItems.insert(o);
                                     }
                                 } else if (ImGui::IsKeyPressed(ImGuiKey_Delete)) {
                                     for (auto j : selectedItems) givenItems.Remove(j);
@@ -1324,6 +1470,15 @@ void QuickArmorRebalance::RenderUI() {
                             ImGui::PopStyleVar(popVar);
                         }
 
+                        // Checked items show what applying would do to them, the rest what has already been done
+                        if (hoveredItem) {
+                            if (auto preview = GetItemPreview(params, hoveredItem))
+                                ImGui::SetTooltip("%s", DescribePreview(*preview).c_str());
+                            else if (g_Data.itemStates.Get(hoveredItem) &
+                                     (ItemStates::kModified | ItemStates::kModifiedShared))
+                                ImGui::SetTooltip("%s", DescribeChanges(hoveredItem).c_str());
+                        }
+
                         ImGui::EndListBox();
                     }
 
@@ -1368,14 +1523,10 @@ void QuickArmorRebalance::RenderUI() {
                     ImGui::EndDisabled();  //! player
 
                     bSlotWarning = false;
-                    for (auto i : params.items) {
-                        if (auto armor = i->As<RE::TESObjectARMO>()) {
-                            auto itemSlots =
-                                MapFindOr(g_Data.modifiedArmorSlots, armor, (ArmorSlots)armor->GetSlotMask());
-                            if ((~g_Config.usedSlotsMask) & (~remappedSrc) & itemSlots) {
-                                bSlotWarning = true;
-                                break;
-                            }
+                    for (auto itemSlots : params.itemSlots) {
+                        if ((~g_Config.usedSlotsMask) & (~remappedSrc) & itemSlots) {
+                            bSlotWarning = true;
+                            break;
                         }
                     }
                 }
@@ -1517,12 +1668,12 @@ void QuickArmorRebalance::RenderUI() {
             uint64_t slotsUsed = 0;
 
             std::vector<RE::TESObjectARMO*> lsSlotItems;
-            for (auto i : g_Config.acParams.items) {
-                if (auto armor = i->As<RE::TESObjectARMO>()) {
-                    auto itemSlots = MapFindOr(g_Data.modifiedArmorSlots, armor, (ArmorSlots)armor->GetSlotMask());
-                    slotsUsed |= itemSlots;
-                    if (itemSlots & ((uint64_t)1 << nSlotView)) lsSlotItems.push_back(armor);
-                }
+            const auto& params = g_Config.acParams;
+            for (std::size_t n = 0; n < params.items.size(); n++) {
+                auto itemSlots = params.itemSlots[n];
+                slotsUsed |= itemSlots;
+                if (itemSlots & ((uint64_t)1 << nSlotView))
+                    lsSlotItems.push_back(params.items[n]->As<RE::TESObjectARMO>());
             }
 
             nSlotView = 33;
@@ -1688,5 +1839,8 @@ void QuickArmorRebalance::RenderUI() {
     ImGuiIntegration::BlockInput(!ImGui::IsWindowCollapsed(), ImGui::IsItemHovered());
     ImGui::End();
 
+    // Build the remaining mod item lists a frame at a time while nothing else is going on
+    if (!ImGui::IsAnyItemActive() && !ImGui::IsPopupOpen(nullptr, ImGuiPopupFlags_AnyPopup)) PopulateNextMod();
+
     if (!isActive) ImGuiIntegration::Show(false);
 }
\ No newline at end of file
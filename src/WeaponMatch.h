@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+
+#include "FlatMap.h"
+
+// Finding the weapon or ammo of an armor set that another one takes its stats from. Only the members CommonLib's
+// weapons and ammo have are used, and what counts as a type keyword or a bolt is passed in, so this builds without the
+// game and the index can be tested against the scan it replaces
+
+namespace QuickArmorRebalance {
+    // The first weapon in the set with the same type whose type keyword the weapon also has. 2h maces use the same
+    // weapon type as 2h axes, so the keyword is what tells them apart
+    template <class Weapon>
+    Weapon* FindMatchingWeapon(const std::set<Weapon*>& weaps, const Weapon* w, const auto& isTypeKeyword) {
+        for (auto i : weaps) {
+            if (i->GetWeaponType() != w->GetWeaponType()) continue;
+
+            for (unsigned int j = 0; j < i->numKeywords; j++) {
+                if (isTypeKeyword(i->keywords[j])) {
+                    if (w->HasKeyword(i->keywords[j])) return i;
+                    break;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    // The first ammo in the set that is a bolt if the ammo is
+    template <class Ammo>
+    Ammo* FindMatchingAmmo(const std::set<Ammo*>& ammo, const Ammo* a, const auto& isBolt) {
+        for (auto i : ammo) {
+            if (isBolt(i) == isBolt(a)) return i;
+        }
+        return nullptr;
+    }
+
+    // Same answers as the scans above, from a table built once the set is complete. Weapons are keyed on their type
+    // and type keyword and keep their position in the set, so the earliest match still wins
+    template <class Weapon, class Ammo>
+    struct BasicMatchIndex
+    {
+        struct Entry {
+            std::size_t order;  // Position in the set
+            Weapon* weap;
+        };
+
+        void Build(const std::set<Weapon*>& weaps, const std::set<Ammo*>& ammo, const auto& isTypeKeyword,
+                   const auto& isBolt) {
+            *this = {};
+
+            std::size_t order = 0;
+            for (auto i : weaps) {
+                for (unsigned int j = 0; j < i->numKeywords; j++) {
+                    if (isTypeKeyword(i->keywords[j])) {
+                        table.try_emplace(Key(i->GetWeaponType(), i->keywords[j]), Entry{order, i});
+                        break;
+                    }
+                }
+                order++;
+            }
+
+            for (auto i : ammo) {
+                auto& slot = bolts[isBolt(i)];
+                if (!slot) slot = i;
+            }
+
+            bBuilt = true;
+        }
+
+        // One probe per keyword on the weapon
+        Weapon* Find(const Weapon* w) const {
+            const Entry* best = nullptr;
+            auto type = w->GetWeaponType();
+            for (unsigned int j = 0; j < w->numKeywords; j++) {
+                if (!w->keywords[j]) continue;
+
+                auto it = table.find(Key(type, w->keywords[j]));
+                if (it != table.end() && (!best || it->second.order < best->order)) best = &it->second;
+            }
+            return best ? best->weap : nullptr;
+        }
+
+        Ammo* Find(const Ammo* a, const auto& isBolt) const { return bolts[isBolt(a)]; }
+
+        static std::uint64_t Key(auto type, const auto* kw) { return (std::uint64_t)type << 32 | kw->formID; }
+
+        FlatMap<std::uint64_t, Entry> table;
+        Ammo* bolts[2] = {};  // Indexed by whether the ammo is a bolt
+        bool bBuilt = false;
+    };
+}
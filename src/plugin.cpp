@@ -2,8 +2,10 @@
 #include "ConsoleCommands.h"
 #include "Data.h"
 #include "ImGUIIntegration.h"
+#include "JsonArena.h"
 #include "UI.h"
 #include "LootLists.h"
+#include "Tasks.h"
 
 namespace QuickArmorRebalance {
     void OnDataLoaded();
@@ -14,7 +16,7 @@ namespace QuickArmorRebalance {
         SKSE::GetPapyrusInterface()->Register(BindPapyrusFunctions);
         SetupLog();
 
-        ImGuiIntegration::Start(RenderUI);
+        ImGuiIntegration::Start(RenderUI, RunTasks);  // Tasks keep going if the menu is closed part way through
         InstallConsoleCommands();
 
         SKSE::GetMessagingInterface()->RegisterListener([](SKSE::MessagingInterface::Message* message) {
@@ -41,8 +43,9 @@ namespace QuickArmorRebalance {
         ProcessData();
         LoadChangesFromFiles();
         SetupLootLists();
+        LogJsonArenaStats();
 
-        g_Data.loot.release();
+        ReleaseLootData();
     }
 
     void Papyrus_OpenUI(RE::StaticFunctionTag*) {
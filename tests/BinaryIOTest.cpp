@@ -0,0 +1,120 @@
+#include "BinaryIO.h"
+
+#include <fstream>
+#include <string>
+
+#include "Check.h"
+
+using namespace QuickArmorRebalance;
+using namespace QuickArmorRebalance::Test;
+
+namespace {
+    // Published FNV-1a 64 test vectors
+    static_assert(HashFNV("") == 0xcbf29ce484222325ull);
+    static_assert(HashFNV("a") == 0xaf63dc4c8601ec8cull);
+    static_assert(HashFNV("foobar") == 0x85944171f73967e8ull);
+
+    struct Chance {
+        int count;
+        int chance;
+    };
+
+    std::filesystem::path TempPath(const char* name) {
+        auto dir = std::filesystem::temp_directory_path() / "qar_tests";
+        std::filesystem::create_directories(dir);
+        return dir / name;
+    }
+
+    void TestHash() {
+        // Files are hashed a buffer at a time by passing the running hash along
+        std::string text = "The quick brown fox jumps over the lazy dog";
+        auto chained = HashFNV(text.substr(0, 10));
+        chained = HashFNV(text.substr(10), chained);
+        CHECK(chained == HashFNV(text));
+
+        auto path = TempPath("hash.txt");
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file << text;
+        }
+        CHECK(HashFile(path) == HashFNV(text));
+        CHECK(HashFile(TempPath("missing.txt")) == 0);
+    }
+
+    void TestRoundTrip() {
+        std::string withNul("a\0b", 3);
+
+        BinaryWriter w;
+        w.Write((std::uint32_t)0x53524151);
+        w.Write((std::uint64_t)0x0123456789abcdefull);
+        w.Write(1.5f);
+        w.Write(Chance{3, 75});
+        w.WriteString("Iron Armor");
+        w.WriteString("");
+        w.WriteString(withNul);
+
+        auto path = TempPath("roundtrip.bin");
+        CHECK(w.Save(path));
+
+        BinaryReader r;
+        CHECK(r.Load(path));
+
+        std::uint32_t magic = 0;
+        std::uint64_t big = 0;
+        float f = 0.0f;
+        Chance chance{};
+        std::string a, b, c;
+        CHECK(r.Read(magic) && magic == 0x53524151);
+        CHECK(r.Read(big) && big == 0x0123456789abcdefull);
+        CHECK(r.Read(f) && f == 1.5f);
+        CHECK(r.Read(chance) && chance.count == 3 && chance.chance == 75);
+        CHECK(r.ReadString(a) && a == "Iron Armor");
+        CHECK(r.ReadString(b) && b.empty());
+        CHECK(r.ReadString(c) && c == withNul);
+        CHECK(r.AtEnd());
+
+        std::uint8_t past;
+        CHECK(!r.Read(past));
+    }
+
+    void TestTruncated() {
+        BinaryWriter w;
+        w.Write((std::uint32_t)7);
+        w.WriteString("Steel Plate");
+
+        auto path = TempPath("truncated.bin");
+        CHECK(w.Save(path));
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+
+        BinaryReader r;
+        CHECK(r.Load(path));
+
+        std::uint32_t n = 0;
+        std::string str;
+        CHECK(r.Read(n) && n == 7);
+        CHECK(!r.ReadString(str));
+
+        // A length that runs past the end is rejected rather than read
+        BinaryWriter bad;
+        bad.Write((std::uint32_t)0xffffffff);
+        bad.Write((std::uint32_t)0);
+        CHECK(bad.Save(path));
+        CHECK(r.Load(path));
+        CHECK(!r.ReadString(str));
+
+        std::uint64_t v;
+        BinaryWriter shortFile;
+        shortFile.Write((std::uint32_t)1);
+        CHECK(shortFile.Save(path));
+        CHECK(r.Load(path) && !r.Read(v));
+
+        CHECK(!r.Load(TempPath("missing.bin")));
+    }
+}
+
+int main() {
+    TestHash();
+    TestRoundTrip();
+    TestTruncated();
+    return TestResult();
+}
@@ -0,0 +1,80 @@
+// Decoding the members of a 10k entry change file: one pass over each entry dispatching on the hash of the name,
+// against looking every field up by scanning the members, the way FindMember did once per field
+#include "ChangeFields.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace QuickArmorRebalance;
+
+namespace {
+    constexpr std::size_t kEntries = 10000;
+    constexpr int kRuns = 50;
+
+    struct Member {
+        std::string name;
+        int value;
+    };
+
+    using Entry = std::vector<Member>;
+
+    std::size_t DecodeByHash(const std::vector<Entry>& entries) {
+        std::size_t sum = 0;
+        for (const auto& e : entries) {
+            const Member* fields[kChangeFields] = {};
+            for (const auto& m : e) {
+                auto f = FindChangeField(m.name);
+                if (f != kNoField && !fields[f]) fields[f] = &m;
+            }
+            for (auto i : fields) sum += i ? i->value : 0;
+        }
+        return sum;
+    }
+
+    std::size_t DecodeByScan(const std::vector<Entry>& entries) {
+        std::size_t sum = 0;
+        for (const auto& e : entries) {
+            const Member* fields[kChangeFields] = {};
+            for (int f = 0; f < kChangeFields; f++) {
+                for (const auto& m : e) {
+                    if (m.name == kChangeFieldNames[f]) {
+                        fields[f] = &m;
+                        break;
+                    }
+                }
+            }
+            for (auto i : fields) sum += i ? i->value : 0;
+        }
+        return sum;
+    }
+
+    template <class Fn>
+    double Time(Fn&& fn, std::size_t& sum) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kRuns; i++) sum += fn();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / kRuns;
+    }
+}
+
+int main() {
+    // Armor and weapon entries as BuildArmorChanges writes them
+    std::vector<Entry> entries;
+    for (std::size_t i = 0; i < kEntries; i++) {
+        int v = (int)i;
+        if (i % 3)
+            entries.push_back({{"name", v}, {"srcname", v}, {"srcfile", v}, {"srcid", v}, {"w", v}, {"armor", v},
+                               {"weight", v}, {"value", v}, {"temper", v}, {"loot", v}});
+        else
+            entries.push_back({{"name", v}, {"srcname", v}, {"srcfile", v}, {"srcid", v}, {"damage", v},
+                               {"weight", v}, {"speed", v}, {"stagger", v}, {"value", v}, {"craft", v}});
+    }
+
+    std::size_t sumHash = 0, sumScan = 0;
+    auto byHash = Time([&] { return DecodeByHash(entries); }, sumHash);
+    auto byScan = Time([&] { return DecodeByScan(entries); }, sumScan);
+
+    std::printf("%zu entries: by hash %.3fms, by scan %.3fms%s\n", kEntries, byHash, byScan,
+                sumHash == sumScan ? "" : ", results differ");
+}
@@ -0,0 +1,52 @@
+#include "ChangeFields.h"
+
+#include <string>
+
+#include "Check.h"
+
+using namespace QuickArmorRebalance;
+using namespace QuickArmorRebalance::Test;
+
+namespace {
+    void TestNames() {
+        for (int i = 0; i < kChangeFields; i++) CHECK(FindChangeField(kChangeFieldNames[i]) == i);
+
+        CHECK(FindChangeField("srcfile") == kFieldSrcFile);
+        CHECK(FindChangeField("w") == kFieldW);
+        CHECK(FindChangeField("craft") == kFieldCraft);
+    }
+
+    void TestNearMisses() {
+        // Members the decoder doesn't know, or that only look like a field, are ignored
+        for (auto name : {"", "name", "srcname", "Armor", "armor ", "armo", "armors", "W", "ww", "src", "srcfil"})
+            CHECK(FindChangeField(name) == kNoField);
+
+        // A name is matched on its length, not up to a terminator
+        std::string padded("slots\0", 6);
+        CHECK(FindChangeField(padded) == kNoField);
+        CHECK(FindChangeField(std::string_view(padded).substr(0, 5)) == kFieldSlots);
+
+        // Every prefix and every single character change of a field name misses, apart from "w" being the start of
+        // "weight"
+        for (auto full : kChangeFieldNames) {
+            for (std::size_t n = 0; n < full.size(); n++) {
+                auto f = FindChangeField(full.substr(0, n));
+                CHECK(f == kNoField || kChangeFieldNames[f] == full.substr(0, n));
+            }
+
+            std::string name(full);
+            for (auto& c : name) {
+                auto orig = c;
+                c ^= 0x20;
+                CHECK(FindChangeField(name) == kNoField);
+                c = orig;
+            }
+        }
+    }
+}
+
+int main() {
+    TestNames();
+    TestNearMisses();
+    return TestResult();
+}
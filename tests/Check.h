@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdio>
+
+// Just enough to write the host tests with. A failed check is reported and the test carries on, main returns
+// TestResult() so ctest sees the failure
+namespace QuickArmorRebalance::Test {
+    inline int failures = 0;
+
+    inline int TestResult() {
+        if (failures) std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return failures ? 1 : 0;
+    }
+}
+
+#define CHECK(x)                                                                        \
+    do {                                                                                \
+        if (!(x)) {                                                                     \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x);  \
+            QuickArmorRebalance::Test::failures++;                                      \
+        }                                                                               \
+    } while (0)
@@ -0,0 +1,159 @@
+#include "ConfigStreams.h"
+
+#include <map>
+#include <vector>
+
+#include "Check.h"
+
+namespace RE {
+    class TESForm
+    {
+    public:
+        std::uint32_t formID;
+    };
+
+    class BGSKeyword : public TESForm
+    {};
+}
+
+using namespace QuickArmorRebalance;
+using namespace QuickArmorRebalance::Test;
+
+namespace {
+    // Same shape as RebalanceCurveNode
+    struct CurveNode {
+        using Tree = std::vector<CurveNode>;
+
+        unsigned int slot = 0;
+        int weight = 0;
+        Tree children;
+
+        bool operator==(const CurveNode&) const = default;
+    };
+
+    std::filesystem::path TempPath(const char* name) {
+        auto dir = std::filesystem::temp_directory_path() / "qar_tests";
+        std::filesystem::create_directories(dir);
+        return dir / name;
+    }
+
+    // Writes what fn writes, then opens it again for reading
+    BinaryReader RoundTrip(const char* name, const auto& fn) {
+        BinaryWriter w;
+        fn(w);
+        auto path = TempPath(name);
+        w.Save(path);
+
+        BinaryReader r;
+        r.Load(path);
+        return r;
+    }
+
+    // Shaped like the shipped curves: the body, with the pieces that hang off it nested a few levels deep
+    CurveNode::Tree MakeCurve() {
+        CurveNode::Tree tree(1);
+        tree[0] = {32, 40};
+        tree[0].children = {{30, 15, {{31, 5}, {43, 2}}}, {33, 10}, {37, 10, {{38, 4, {{40, 1}}}}}};
+        return tree;
+    }
+
+    void TestCurve() {
+        auto tree = MakeCurve();
+        auto r = RoundTrip("curve.bin", [&](auto& w) { WriteCurve(w, tree); });
+
+        CurveNode::Tree read;
+        CHECK(ReadCurve(r, read));
+        CHECK(read == tree);
+        CHECK(r.AtEnd());
+    }
+
+    void TestCurveRejected() {
+        // Deeper than there are slots to nest
+        CurveNode::Tree deep(1);
+        auto* node = &deep[0];
+        for (int i = 0; i < kMaxCurveDepth + 2; i++) {
+            node->children.resize(1);
+            node = &node->children[0];
+        }
+        auto r = RoundTrip("curve_deep.bin", [&](auto& w) { WriteCurve(w, deep); });
+        CurveNode::Tree read;
+        CHECK(!ReadCurve(r, read));
+
+        // More nodes on a level than there are slots
+        CurveNode::Tree wide(kMaxCurveDepth + 1);
+        r = RoundTrip("curve_wide.bin", [&](auto& w) { WriteCurve(w, wide); });
+        CHECK(!ReadCurve(r, read));
+
+        // Cut short, a node's children counted but not there
+        r = RoundTrip("curve_short.bin", [&](auto& w) {
+            w.Write((std::uint32_t)1);
+            w.Write(32u);
+            w.Write(40);
+            w.Write((std::uint32_t)2);
+        });
+        CHECK(!ReadCurve(r, read));
+    }
+
+    void TestForms() {
+        std::vector<RE::BGSKeyword> keywords(10);
+        std::map<std::uint32_t, RE::BGSKeyword*> byId;
+        for (std::uint32_t i = 0; i < keywords.size(); i++) {
+            keywords[i].formID = 0x01000800 + i;
+            byId[keywords[i].formID] = &keywords[i];
+        }
+        auto lookup = [&](std::uint32_t id) -> RE::BGSKeyword* {
+            auto it = byId.find(id);
+            return it != byId.end() ? it->second : nullptr;
+        };
+
+        std::set<RE::BGSKeyword*> set{&keywords[1], &keywords[4], &keywords[9]};
+        auto r = RoundTrip("forms.bin", [&](auto& w) {
+            WriteForms(w, set);
+            WriteForms(w, std::set<RE::BGSKeyword*>{});
+        });
+
+        std::set<RE::BGSKeyword*> read, empty;
+        CHECK(ReadForms(r, read, lookup) && read == set);
+        CHECK(ReadForms(r, empty, lookup) && empty.empty());
+        CHECK(r.AtEnd());
+
+        // A form that's gone from the load order fails the read
+        byId.erase(keywords[4].formID);
+        r = RoundTrip("forms_missing.bin", [&](auto& w) { WriteForms(w, set); });
+        read.clear();
+        CHECK(!ReadForms(r, read, lookup));
+    }
+
+    void TestContainers() {
+        std::vector<RE::TESForm> forms(4);
+        for (std::uint32_t i = 0; i < forms.size(); i++) forms[i].formID = 0x000a0000 + i;
+        auto lookup = [&](std::uint32_t id) -> RE::TESForm* {
+            for (auto& i : forms)
+                if (i.formID == id) return &i;
+            return nullptr;
+        };
+
+        ContainerList list;
+        list[&forms[0]] = {1, 100};
+        list[&forms[2]] = {3, 25};
+        list[&forms[3]] = {2, 50};
+        auto r = RoundTrip("containers.bin", [&](auto& w) { WriteContainers(w, list); });
+
+        ContainerList read;
+        CHECK(ReadContainers(r, read, lookup));
+        CHECK(read.size() == list.size());
+        for (const auto& [form, chance] : list) {
+            auto it = read.find(form);
+            CHECK(it != read.end() && it->second.count == chance.count && it->second.chance == chance.chance);
+        }
+        CHECK(r.AtEnd());
+    }
+}
+
+int main() {
+    TestCurve();
+    TestCurveRejected();
+    TestForms();
+    TestContainers();
+    return TestResult();
+}
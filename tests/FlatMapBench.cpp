@@ -0,0 +1,74 @@
+// Lookups of item pointers the way the UI and change code make them, FlatMap against std::unordered_map
+#include "FlatMap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace QuickArmorRebalance;
+
+namespace {
+    struct Form {
+        char data[0x100];  // Roughly the size of an armor form, so keys are spread like real ones
+    };
+
+    template <class Map>
+    double TimeLookups(const Map& map, const std::vector<Form*>& keys, int rounds, std::size_t& sum) {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++)
+            for (auto k : keys) sum += map.find(k)->second;
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+               ((double)rounds * keys.size());
+    }
+
+    template <class Map>
+    double TimeInserts(const std::vector<Form*>& keys, int rounds, std::size_t& sum) {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) {
+            Map map;
+            for (std::uint32_t i = 0; i < keys.size(); i++) map.try_emplace(keys[i], i);
+            sum += map.size();
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+               ((double)rounds * keys.size());
+    }
+}
+
+int main() {
+    std::mt19937 rng(1);
+
+    for (std::size_t n : {2000, 20000, 200000}) {
+        // Forms are allocated in batches as plugins load, so some are close together and some far apart
+        std::vector<std::unique_ptr<Form[]>> blocks;
+        std::vector<Form*> keys;
+        while (keys.size() < n) {
+            auto count = std::min<std::size_t>(n - keys.size(), 64);
+            blocks.push_back(std::make_unique<Form[]>(count));
+            for (std::size_t i = 0; i < count; i++) keys.push_back(&blocks.back()[i]);
+        }
+
+        std::unordered_map<Form*, std::uint32_t> node;
+        FlatMap<Form*, std::uint32_t> flat;
+        for (std::uint32_t i = 0; i < keys.size(); i++) {
+            node.try_emplace(keys[i], i);
+            flat.try_emplace(keys[i], i);
+        }
+
+        auto order = keys;
+        std::shuffle(order.begin(), order.end(), rng);
+
+        int rounds = (int)(4000000 / n);
+        std::size_t sum = 0;
+        auto nodeFind = TimeLookups(node, order, rounds, sum);
+        auto flatFind = TimeLookups(flat, order, rounds, sum);
+        auto nodeAdd = TimeInserts<std::unordered_map<Form*, std::uint32_t>>(keys, rounds, sum);
+        auto flatAdd = TimeInserts<FlatMap<Form*, std::uint32_t>>(keys, rounds, sum);
+
+        std::printf("%7zu items  find: unordered_map %5.1fns  FlatMap %5.1fns", n, nodeFind, flatFind);
+        std::printf("  insert: unordered_map %5.1fns  FlatMap %5.1fns  (%zu)\n", nodeAdd, flatAdd, sum & 1);
+    }
+}
@@ -0,0 +1,116 @@
+#include "FlatMap.h"
+
+#include <cctype>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Check.h"
+
+using namespace QuickArmorRebalance;
+using namespace QuickArmorRebalance::Test;
+
+namespace {
+    struct Form {
+        int id;
+    };
+
+    void TestPointerKeys() {
+        // Forms are allocated close together, so the keys only differ in a few bits
+        std::vector<Form> forms(50000);
+        for (int i = 0; i < (int)forms.size(); i++) forms[i].id = i;
+
+        FlatMap<Form*, std::uint32_t> map;
+        for (auto& f : forms) {
+            auto [it, inserted] = map.try_emplace(&f, (std::uint32_t)f.id);
+            CHECK(inserted && it->second == (std::uint32_t)f.id);
+        }
+        CHECK(map.size() == forms.size());
+
+        bool bAllFound = true;
+        for (auto& f : forms) {
+            auto it = map.find(&f);
+            bAllFound &= it != map.end() && it->first == &f && it->second == (std::uint32_t)f.id;
+        }
+        CHECK(bAllFound);
+
+        Form missing{-1};
+        CHECK(map.find(&missing) == map.end());
+        CHECK(!map.contains(&missing));
+
+        // Adding again keeps what's there
+        auto [it, inserted] = map.try_emplace(&forms[10], 99u);
+        CHECK(!inserted && it->second == 10);
+
+        // Entries come back in the order they were added
+        std::uint32_t n = 0;
+        bool bInOrder = true;
+        for (auto& [form, id] : map) bInOrder &= form == &forms[n] && id == n++;
+        CHECK(bInOrder);
+
+        map.clear();
+        CHECK(map.empty() && map.find(&forms[0]) == map.end());
+        map[&forms[3]] = 7;
+        CHECK(map.size() == 1 && map[&forms[3]] == 7);
+    }
+
+    void TestEmpty() {
+        const FlatMap<Form*, int> map;
+        Form f{};
+        CHECK(map.find(&f) == map.end());
+        CHECK(map.begin() == map.end());
+
+        FlatMap<Form*, int> reserved;
+        reserved.reserve(1000);
+        CHECK(reserved.find(&f) == reserved.end());
+        reserved[&f] = 1;
+        CHECK(reserved.contains(&f));
+    }
+
+    struct FoldedHash {
+        std::size_t operator()(std::string_view str) const {
+            std::size_t hash = 14695981039346656037ull;
+            for (auto c : str) hash = (hash ^ (unsigned char)std::tolower(c)) * 1099511628211ull;
+            return hash;
+        }
+    };
+
+    struct FoldedEqual {
+        bool operator()(std::string_view a, std::string_view b) const {
+            if (a.size() != b.size()) return false;
+            for (std::size_t i = 0; i < a.size(); i++)
+                if (std::tolower(a[i]) != std::tolower(b[i])) return false;
+            return true;
+        }
+    };
+
+    // Same shape as NameRegistry, the map only holds views into strings kept elsewhere
+    void TestFoldedNames() {
+        std::vector<std::unique_ptr<std::string>> names;
+        FlatMap<std::string_view, int, FoldedHash, FoldedEqual> ids;
+
+        auto intern = [&](std::string_view name) {
+            if (auto it = ids.find(name); it != ids.end()) return it->second;
+            auto id = (int)names.size();
+            names.push_back(std::make_unique<std::string>(name));
+            ids.emplace(*names.back(), id);
+            return id;
+        };
+
+        for (int i = 0; i < 1000; i++) intern("Group" + std::to_string(i));
+        CHECK(intern("GROUP12") == 12);
+        CHECK(intern("group999") == 999);
+        CHECK(intern("Group1000") == 1000);
+        CHECK(ids.size() == 1001);
+        CHECK(ids.find("Group") == ids.end());
+    }
+}
+
+int main() {
+    TestPointerKeys();
+    TestEmpty();
+    TestFoldedNames();
+    return TestResult();
+}
@@ -0,0 +1,91 @@
+// One frame of the item list for a 50k item selection: the row flags, the modified filter and the original slots
+// BuildArmorChanges needs. Looking each item up by pointer against indexing with the ordinal the list carries
+#include "ItemStates.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace RE {
+    class TESBoundObject
+    {
+    public:
+        char data[0x100];  // Roughly the size of an armor form
+        unsigned int slots = 0;
+    };
+}
+
+using namespace QuickArmorRebalance;
+
+namespace {
+    constexpr std::size_t kItems = 50000;
+    constexpr int kFrames = 200;
+
+    // Before: every row asked the state by pointer, as Get(item) and GetOriginalSlots(armor) did
+    std::size_t FrameByItem(const ItemStates& states, const std::vector<RE::TESBoundObject*>& list) {
+        std::size_t sum = 0;
+        for (auto i : list) {
+            auto o = states.Find(i);
+            auto f = o != ItemStates::kNone ? states.flags[o] : 0;
+            if (f & (ItemStates::kModified | ItemStates::kModifiedShared)) continue;
+
+            o = states.Find(i);
+            sum += f + (o != ItemStates::kNone && (states.flags[o] & ItemStates::kSlotsOverridden) ? states.origSlots[o]
+                                                                                                    : i->slots);
+        }
+        return sum;
+    }
+
+    std::size_t FrameByOrdinal(const ItemStates& states, const std::vector<RE::TESBoundObject*>& list,
+                               const std::vector<ItemStates::Ordinal>& ordinals) {
+        std::size_t sum = 0;
+        for (std::size_t n = 0; n < list.size(); n++) {
+            auto o = ordinals[n];
+            auto f = states.Get(o);
+            if (f & (ItemStates::kModified | ItemStates::kModifiedShared)) continue;
+            sum += f + states.GetOriginalSlots(o, list[n]->slots);
+        }
+        return sum;
+    }
+
+    template <class Fn>
+    double Time(Fn&& fn, std::size_t& sum) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kFrames; i++) sum += fn();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / kFrames;
+    }
+}
+
+int main() {
+    std::mt19937 rng(1);
+
+    // Tracked in load order, listed in name order, which has nothing to do with it
+    std::vector<std::unique_ptr<RE::TESBoundObject[]>> blocks;
+    std::vector<RE::TESBoundObject*> forms;
+    while (forms.size() < kItems) {
+        blocks.push_back(std::make_unique<RE::TESBoundObject[]>(64));
+        for (int i = 0; i < 64; i++) forms.push_back(&blocks.back()[i]);
+    }
+
+    ItemStates states;
+    for (auto i : forms) {
+        auto o = states.Track(i);
+        i->slots = 1u << (o % 32);
+        if (o % 7 == 0) states.SetOriginalSlots(o, 0x4);
+        if (o % 11 == 0) states.flags[o] |= ItemStates::kModified;
+    }
+
+    auto list = forms;
+    std::shuffle(list.begin(), list.end(), rng);
+    std::vector<ItemStates::Ordinal> ordinals;
+    for (auto i : list) ordinals.push_back(states.Find(i));
+
+    std::size_t sum = 0;
+    auto byItem = Time([&] { return FrameByItem(states, list); }, sum);
+    auto byOrdinal = Time([&] { return FrameByOrdinal(states, list, ordinals); }, sum);
+
+    std::printf("%zu items per frame: by item %.3fms, by ordinal %.3fms (%zu)\n", kItems, byItem, byOrdinal, sum & 1);
+}
@@ -0,0 +1,83 @@
+#include "ItemStates.h"
+
+#include <vector>
+
+#include "Check.h"
+
+namespace RE {
+    class TESBoundObject
+    {
+    public:
+        int id = 0;
+    };
+}
+
+using namespace QuickArmorRebalance;
+using namespace QuickArmorRebalance::Test;
+
+namespace {
+    void TestOrdinals() {
+        std::vector<RE::TESBoundObject> forms(1000);
+        ItemStates states;
+
+        for (std::size_t n = 0; n < forms.size(); n++) CHECK(states.Track(&forms[n]) == n);
+        CHECK(states.Track(&forms[10]) == 10);
+        CHECK(states.items.size() == forms.size() && states.flags.size() == forms.size());
+
+        RE::TESBoundObject untracked;
+        CHECK(states.Find(&untracked) == ItemStates::kNone);
+        CHECK(states.Get(&untracked) == 0);
+        CHECK(states.Get(ItemStates::kNone) == 0);
+
+        states.flags[5] = ItemStates::kModified;
+        CHECK(states.Get(5) == ItemStates::kModified && states.Get(&forms[5]) == ItemStates::kModified);
+
+        // Slots only come from the column once something overrode them
+        CHECK(states.GetOriginalSlots(7, 0x4) == 0x4);
+        states.SetOriginalSlots(7, 0x10);
+        CHECK(states.GetOriginalSlots(7, 0x4) == 0x10);
+        CHECK(states.GetOriginalSlots(ItemStates::kNone, 0x4) == 0x4);
+    }
+
+    void TestFlagSet() {
+        std::vector<RE::TESBoundObject> forms(100);
+        ItemStates states;
+        for (auto& i : forms) states.Track(&i);
+
+        ItemFlagSet selected{states, ItemStates::kSelected};
+        ItemFlagSet unchecked{states, ItemStates::kUnchecked};
+
+        // Ordinals and items are the same entry
+        selected.insert(3u);
+        selected.insert(&forms[3]);
+        selected.insert(&forms[50]);
+        CHECK(selected.size() == 2);
+        CHECK(selected.contains(&forms[3]) && selected.contains(50u) && !selected.contains(4u));
+        CHECK(!unchecked.contains(3u));
+
+        std::vector<RE::TESBoundObject*> seen;
+        for (auto i : selected) seen.push_back(i);
+        CHECK(seen == std::vector<RE::TESBoundObject*>({&forms[3], &forms[50]}));
+
+        selected.erase(&forms[3]);
+        selected.erase(3u);
+        selected.erase(ItemStates::kNone);
+        CHECK(selected.size() == 1 && !selected.contains(3u));
+
+        // Items inserted by pointer get tracked
+        RE::TESBoundObject extra;
+        std::vector<ItemStates::Ordinal> some{1, 2, 3};
+        unchecked.insert(some.begin(), some.end());
+        unchecked.insert(&extra);
+        CHECK(unchecked.size() == 4 && states.Find(&extra) == 100);
+
+        unchecked.clear();
+        CHECK(unchecked.empty() && !unchecked.contains(&extra) && selected.contains(50u));
+    }
+}
+
+int main() {
+    TestOrdinals();
+    TestFlagSet();
+    return TestResult();
+}
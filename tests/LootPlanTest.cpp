@@ -0,0 +1,261 @@
+#include "LootPlan.h"
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "Check.h"
+
+// The planner only passes forms around, so stand-ins that are never looked inside will do
+namespace RE {
+    class TESBoundObject
+    {};
+    class TESFile
+    {};
+    class TESForm
+    {};
+}
+
+using namespace QuickArmorRebalance;
+using namespace QuickArmorRebalance::Test;
+
+namespace {
+    using Kind = LootAssignment::Kind;
+    using Counts = std::map<RE::TESBoundObject*, int>;
+
+    // Everything a test plans from. Deques, so what the assignments point at doesn't move as more is added
+    struct World {
+        std::deque<RE::TESBoundObject> items;
+        std::deque<RE::TESForm> containerForms;
+        std::deque<ContainerList> containers;
+        std::deque<LootSet> sets;
+        RE::TESFile modA, modB;
+        LootCurve group{.level = 1};  // A single level, so the curve list has one entry
+
+        RE::TESBoundObject* Item() { return &items.emplace_back(); }
+
+        const ContainerList* Containers(int count = 1, int chance = 100) {
+            auto& list = containers.emplace_back();
+            list[&containerForms.emplace_back()] = {count, chance};
+            return &list;
+        }
+
+        const LootSet* Set(std::initializer_list<std::uint32_t> slots) {
+            auto& set = sets.emplace_back();
+            for (auto i : slots) set.push_back({Item(), i});
+            return &set;
+        }
+    };
+
+    LootAssignment Piece(const ContainerList* containers, const LootCurve* group, int rarity, const RE::TESFile* mod,
+                         RE::TESBoundObject* item) {
+        return {0, Kind::Piece, containers, group, rarity, mod, item, nullptr};
+    }
+
+    LootAssignment SetOf(const ContainerList* containers, const LootCurve* group, const LootSet* set) {
+        return {0, Kind::Set, containers, group, 0, nullptr, nullptr, set};
+    }
+
+    const LootPlan::List& ListOf(const LootPlan& plan, LootRef ref) {
+        static const LootPlan::List empty;
+        CHECK(ref.type == LootRef::Type::List && ref.index < plan.lists.size());
+        return ref.type == LootRef::Type::List && ref.index < plan.lists.size() ? plan.lists[ref.index] : empty;
+    }
+
+    // The list the only fill points at, through its one level of the curve
+    const LootPlan::List& ContentsOf(const LootPlan& plan, std::size_t fill = 0) {
+        const auto& curve = ListOf(plan, plan.fills[fill].list);
+        CHECK(curve.entries.size() == 1);
+        return ListOf(plan, curve.entries.front().ref);
+    }
+
+    // How many times each form can be reached under ref
+    void CountForms(const LootPlan& plan, LootRef ref, Counts& counts) {
+        if (ref.type == LootRef::Type::Form)
+            counts[ref.form]++;
+        else if (ref.type == LootRef::Type::List)
+            for (const auto& e : plan.lists[ref.index].entries) CountForms(plan, e.ref, counts);
+    }
+
+    // Counts the list's entries by type, and the forms and lists they point at
+    std::map<LootRef::Type, int> CountEntries(const LootPlan::List& list, Counts& forms,
+                                              std::map<std::uint32_t, int>& lists) {
+        std::map<LootRef::Type, int> types;
+        for (const auto& e : list.entries) {
+            types[e.ref.type]++;
+            if (e.ref.type == LootRef::Type::Form) forms[e.ref.form]++;
+            if (e.ref.type == LootRef::Type::List) lists[e.ref.index]++;
+        }
+        return types;
+    }
+
+    void TestRarityWeights() {
+        World w;
+        auto containers = w.Containers();
+        auto common = w.Item(), uncommon = w.Item(), rare = w.Item();
+        std::vector<LootAssignment> assignments{Piece(containers, &w.group, 0, &w.modA, common),
+                                                Piece(containers, &w.group, 1, &w.modA, uncommon),
+                                                Piece(containers, &w.group, 2, &w.modA, rare)};
+
+        auto plan = PlanLootLists(assignments, {.bNormalizeModDrops = false});
+        CHECK(ValidateLootPlan(plan));
+        CHECK(plan.fills.size() == 1 && plan.fills[0].target == containers->begin()->first);
+
+        // 15 to 4 to 1 between the rarities
+        Counts forms;
+        std::map<std::uint32_t, int> lists;
+        const auto& contents = ContentsOf(plan);
+        CountEntries(contents, forms, lists);
+        CHECK(contents.entries.size() == 20);
+        CHECK(forms[common] == 15 && forms[uncommon] == 4 && forms[rare] == 1);
+        CHECK(contents.flags == LootPlan::List::kCalculateForEachItemInCount);
+
+        // A missing rarity leaves its share empty when null loot is on, instead of handing it to the others
+        assignments.erase(assignments.begin() + 1);
+        plan = PlanLootLists(assignments, {.bNormalizeModDrops = false, .bEnableRarityNullLoot = true});
+        CHECK(ValidateLootPlan(plan));
+
+        forms.clear();
+        const auto& withNull = ContentsOf(plan);
+        auto types = CountEntries(withNull, forms, lists);
+        CHECK(withNull.entries.size() == 20);
+        CHECK(forms[common] == 15 && forms[rare] == 1 && types[LootRef::Type::None] == 4);
+
+        // A single rarity goes straight in, or with null loot gets a list with the chance of nothing the rest make
+        std::vector<LootAssignment> onlyUncommon{Piece(containers, &w.group, 1, &w.modA, uncommon)};
+        plan = PlanLootLists(onlyUncommon, {.bNormalizeModDrops = false});
+        CHECK(ValidateLootPlan(plan));
+        CHECK(ListOf(plan, plan.fills[0].list).entries.front().ref.form == uncommon);
+
+        plan = PlanLootLists(onlyUncommon, {.bNormalizeModDrops = false, .bEnableRarityNullLoot = true});
+        CHECK(ValidateLootPlan(plan));
+        const auto& single = ContentsOf(plan);
+        CHECK(single.chanceNone == 80 && single.entries.size() == 1 && single.entries[0].ref.form == uncommon);
+    }
+
+    void TestSplitLargeLists() {
+        // Up to lists big enough that even the list of sublists has to be split
+        for (auto n : {kLLMaxSize, kLLMaxSize + 1, kLLMaxSize * 2 + 1, kLLMaxSize * 3 + 90, kLLMaxSize * 300}) {
+            World w;
+            auto containers = w.Containers();
+            std::vector<LootAssignment> assignments;
+            for (std::size_t i = 0; i < n; i++)
+                assignments.push_back(Piece(containers, &w.group, 0, &w.modA, w.Item()));
+
+            auto plan = PlanLootLists(assignments, {.bNormalizeModDrops = false});
+            CHECK(ValidateLootPlan(plan));  // Which includes no list being over the size limit
+
+            // Every piece still in there, exactly once
+            Counts counts;
+            CountForms(plan, plan.fills[0].list, counts);
+            bool bOnce = counts.size() == n;
+            for (const auto& [form, count] : counts) bOnce &= count == 1;
+            CHECK(bOnce);
+
+            // Split into lists about the same size, so pieces keep about the same odds
+            const auto& contents = ContentsOf(plan);
+            if (n <= kLLMaxSize) {
+                CHECK(contents.entries.size() == n);
+                continue;
+            }
+
+            std::size_t smallest = n, largest = 0;
+            for (const auto& e : contents.entries) {
+                Counts sub;
+                CountForms(plan, e.ref, sub);
+                smallest = std::min(smallest, sub.size());
+                largest = std::max(largest, sub.size());
+            }
+            CHECK(largest - smallest <= contents.entries.size());
+        }
+    }
+
+    void TestSharedSets() {
+        World w;
+        auto set = w.Set({1 << 2, 1 << 3, 1 << 7});
+        auto overlapping = w.Set({1 << 2, 1 << 2 | 1 << 3, 1 << 5});
+        auto unused = w.Set({1 << 2});
+
+        // Two container groups take the same sets, a third has no containers
+        auto large1 = w.Containers(1, 100);
+        auto large2 = w.Containers(2, 100);
+        ContainerList none;
+        std::vector<LootAssignment> assignments{SetOf(large1, &w.group, set), SetOf(large1, &w.group, overlapping),
+                                                SetOf(large2, &w.group, set), SetOf(large2, &w.group, overlapping),
+                                                SetOf(&none, &w.group, unused)};
+        assignments[2].containerGroup = assignments[3].containerGroup = 1;
+        assignments[4].containerGroup = 2;
+
+        auto plan = PlanLootLists(assignments, {.bNormalizeModDrops = false});
+        CHECK(ValidateLootPlan(plan));
+        CHECK(plan.fills.size() == 2);
+
+        // One use-all list per set that went somewhere, none for the set that didn't
+        std::vector<std::uint32_t> setLists;
+        for (std::uint32_t i = 0; i < plan.lists.size(); i++)
+            if (plan.lists[i].flags & LootPlan::List::kUseAll) setLists.push_back(i);
+        CHECK(setLists.size() == 2);
+
+        Counts unusedForms;
+        for (const auto& i : plan.lists)
+            for (const auto& e : i.entries)
+                if (e.ref.form == (*unused)[0].item) unusedForms[e.ref.form]++;
+        CHECK(unusedForms.empty());
+
+        // Both groups point at the same set lists
+        for (std::size_t fill = 0; fill < 2; fill++) {
+            Counts forms;
+            std::map<std::uint32_t, int> lists;
+            CountEntries(ContentsOf(plan, fill), forms, lists);
+            CHECK(lists.size() == 2);
+            for (auto i : setLists) CHECK(lists.contains(i));
+        }
+
+        // Pieces sharing slots are picked between, the rest all go in
+        for (auto i : setLists) {
+            Counts forms;
+            std::map<std::uint32_t, int> lists;
+            auto types = CountEntries(plan.lists[i], forms, lists);
+            if (forms.contains((*set)[0].item)) {
+                CHECK(types[LootRef::Type::Form] == 3 && lists.empty());
+            } else {
+                CHECK(types[LootRef::Type::Form] == 1 && lists.size() == 1);
+                const auto& pick = plan.lists[lists.begin()->first];
+                CHECK(pick.flags == 0 && pick.entries.size() == 2);
+            }
+        }
+    }
+
+    void TestNormalizeModDrops() {
+        World w;
+        auto containers = w.Containers();
+
+        // One mod with a single piece, another with three
+        std::vector<LootAssignment> assignments{Piece(containers, &w.group, 0, &w.modA, w.Item())};
+        for (int i = 0; i < 3; i++) assignments.push_back(Piece(containers, &w.group, 0, &w.modB, w.Item()));
+
+        // Off, every piece gets the same share
+        auto plan = PlanLootLists(assignments, {.bNormalizeModDrops = false});
+        CHECK(ValidateLootPlan(plan));
+        Counts forms;
+        std::map<std::uint32_t, int> lists;
+        CountEntries(ContentsOf(plan), forms, lists);
+        CHECK(forms.size() == 4 && lists.empty());
+
+        // On, every mod does: the single piece against a list of the other three
+        plan = PlanLootLists(assignments, {.bNormalizeModDrops = true});
+        CHECK(ValidateLootPlan(plan));
+        forms.clear();
+        CountEntries(ContentsOf(plan), forms, lists);
+        CHECK(forms.size() == 1 && forms.contains(assignments[0].item));
+        CHECK(lists.size() == 1 && plan.lists[lists.begin()->first].entries.size() == 3);
+    }
+}
+
+int main() {
+    TestRarityWeights();
+    TestSplitLargeLists();
+    TestSharedSets();
+    TestNormalizeModDrops();
+    return TestResult();
+}
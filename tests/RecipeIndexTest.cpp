@@ -0,0 +1,104 @@
+#include "RecipeIndex.h"
+
+#include <vector>
+
+#include "Check.h"
+
+using namespace QuickArmorRebalance;
+using namespace QuickArmorRebalance::Test;
+
+namespace {
+    struct Keyword {};
+    struct Item {};
+    struct Recipe {
+        Keyword* benchKeyword;
+    };
+
+    using Index = BasicRecipeIndex<Item, Recipe>;
+
+    // True when every bench's recipes are next to each other
+    bool IsGrouped(const Index::RecipeList& ls) {
+        for (std::size_t i = 0; i < ls.size(); i++) {
+            for (std::size_t j = i + 1; j < ls.size(); j++) {
+                if (ls[j]->benchKeyword != ls[i]->benchKeyword) continue;
+                for (auto k = i + 1; k < j; k++)
+                    if (ls[k]->benchKeyword != ls[i]->benchKeyword) return false;
+            }
+        }
+        return true;
+    }
+
+    // The bench's recipes in the list, in the order they appear
+    std::vector<Recipe*> OnBench(const Index::RecipeList& ls, Keyword* bench) {
+        std::vector<Recipe*> r;
+        for (auto i : ls)
+            if (i->benchKeyword == bench) r.push_back(i);
+        return r;
+    }
+
+    void TestGrouping() {
+        Keyword forge, tanning, workbench;
+        Item sword, shield, helmet;
+
+        // Recipes come out of the form array in any order, interleaved between items and benches
+        std::vector<Recipe> recipes{{&forge},     {&tanning}, {&forge},  {&workbench}, {&tanning},
+                                    {&workbench}, {&forge},   {&tanning}, {nullptr},   {&forge}};
+        std::vector<Item*> created{&sword, &sword, &sword, &sword, &sword, &shield, &sword, &shield, &sword, &shield};
+
+        Index index;
+        for (std::size_t i = 0; i < recipes.size(); i++) index.Add(created[i], &recipes[i]);
+
+        auto ls = index.Find(&sword);
+        CHECK(ls && ls->size() == 7);
+        CHECK(ls && IsGrouped(*ls));
+
+        // Within a bench they keep the order they were added in
+        CHECK(ls && OnBench(*ls, &forge) == std::vector<Recipe*>({&recipes[0], &recipes[2], &recipes[6]}));
+        CHECK(ls && OnBench(*ls, &tanning) == std::vector<Recipe*>({&recipes[1], &recipes[4]}));
+        CHECK(ls && OnBench(*ls, nullptr) == std::vector<Recipe*>({&recipes[8]}));
+
+        auto ls2 = index.Find(&shield);
+        CHECK(ls2 && ls2->size() == 3 && IsGrouped(*ls2));
+
+        CHECK(!index.Find(&helmet));
+    }
+
+    void TestRemove() {
+        Keyword forge, tanning;
+        Item boots;
+        Recipe a{&forge}, b{&tanning}, c{&forge};
+
+        Index index;
+        index.Add(&boots, &a);
+        index.Add(&boots, &b);
+        index.Add(&boots, &c);
+
+        index.Remove(&boots, &a);
+        auto ls = index.Find(&boots);
+        CHECK(ls && ls->size() == 2 && OnBench(*ls, &forge) == std::vector<Recipe*>({&c}));
+
+        // Removing what isn't there does nothing
+        index.Remove(&boots, &a);
+        Item other;
+        index.Remove(&other, &a);
+        CHECK(index.Find(&boots)->size() == 2);
+
+        index.Remove(&boots, &b);
+        index.Remove(&boots, &c);
+        CHECK(!index.Find(&boots));
+
+        // A removed recipe can come back, behind any left on its bench
+        index.Add(&boots, &c);
+        index.Add(&boots, &b);
+        index.Add(&boots, &a);
+        ls = index.Find(&boots);
+        CHECK(ls && ls->size() == 3 && IsGrouped(*ls));
+        CHECK(ls && OnBench(*ls, &forge) == std::vector<Recipe*>({&c, &a}));
+    }
+}
+
+int main() {
+    TestGrouping();
+    TestRemove();
+    return TestResult();
+}
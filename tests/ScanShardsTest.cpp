@@ -0,0 +1,97 @@
+// The form scan splits the form arrays into chunks, scans them on worker threads into one shard each, then merges the
+// shards in chunk order. That has to give exactly what a serial scan does
+#include "ModGroups.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+
+using namespace QuickArmorRebalance;
+using namespace QuickArmorRebalance::Test;
+
+namespace {
+    struct Mod {
+        std::string name;
+    };
+
+    struct Item {
+        Mod* mod;
+        bool bPlayable;
+    };
+
+    struct Shard {
+        ModGroups<Mod, Item> items;
+        std::vector<Item*> invalid;
+
+        void AddItem(Item* i) {
+            if (!i->bPlayable)
+                invalid.push_back(i);
+            else
+                items.Add(i->mod, i);
+        }
+    };
+
+    std::vector<Mod*> SortedMods(const ModGroups<Mod, Item>& groups) {
+        std::vector<Mod*> r;
+        for (const auto& i : groups.mods) r.push_back(i.first);
+        std::sort(r.begin(), r.end(), [](Mod* a, Mod* b) { return a->name < b->name; });
+        return r;
+    }
+
+    void TestMatchesSerial(std::size_t nItems, std::size_t chunkSize) {
+        std::mt19937 rng((unsigned)nItems);
+
+        std::vector<Mod> mods(60);
+        for (std::size_t n = 0; n < mods.size(); n++) mods[n].name = "Mod" + std::to_string((n * 37) % 60);
+
+        // Mostly runs of items from the same plugin like a real form array, with overrides scattered through it
+        std::vector<Item> catalog(nItems);
+        std::size_t cur = 0;
+        for (auto& i : catalog) {
+            if (rng() % 50 == 0) cur = rng() % mods.size();
+            i.mod = rng() % 10 == 0 ? &mods[rng() % mods.size()] : &mods[cur];
+            i.bPlayable = rng() % 13 != 0;
+        }
+
+        Shard serial;
+        for (auto& i : catalog) serial.AddItem(&i);
+
+        std::size_t nChunks = (catalog.size() + chunkSize - 1) / chunkSize;
+        std::vector<Shard> shards(nChunks);
+        std::vector<std::atomic<int>> runs(nChunks);
+        ParallelFor(nChunks, [&](std::size_t n) {
+            runs[n]++;
+            auto end = std::min(catalog.size(), (n + 1) * chunkSize);
+            for (auto i = n * chunkSize; i < end; i++) shards[n].AddItem(&catalog[i]);
+        });
+
+        bool bEachOnce = true;
+        for (auto& i : runs) bEachOnce &= i == 1;
+        CHECK(bEachOnce);
+
+        ModGroups<Mod, Item> merged;
+        std::vector<Item*> invalid;
+        for (const auto& i : shards) {
+            merged.Add(i.items);
+            invalid.insert(invalid.end(), i.invalid.begin(), i.invalid.end());
+        }
+
+        CHECK(merged.mods == serial.items.mods);
+        CHECK(invalid == serial.invalid);
+        CHECK(SortedMods(merged) == SortedMods(serial.items));
+    }
+}
+
+int main() {
+    TestMatchesSerial(0, 2048);
+    TestMatchesSerial(1, 2048);
+    TestMatchesSerial(5000, 2048);
+    TestMatchesSerial(100000, 2048);
+    TestMatchesSerial(100000, 7);
+    return TestResult();
+}
@@ -0,0 +1,93 @@
+// The stats of a 50k armor change load: each item scaled on its own with the zero checks branching per field, as
+// ChangeField did, against gathering them into StatColumns and computing each column in one pass. Only the math is
+// timed, the json lookups per field that ChangeField also did aren't part of either side
+#include "StatMath.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace QuickArmorRebalance;
+
+namespace {
+    constexpr std::size_t kItems = 50000;
+    constexpr int kRuns = 50;
+
+    struct Armor {
+        std::uint32_t armorRating;
+        float weight;
+        std::int32_t value;
+    };
+
+    struct Change {
+        const Armor* src;
+        float scale;
+        float w;
+    };
+
+    template <class T>
+    T Scalar(T src, float scale, const auto& fn) {
+        if (src && scale > 0.0f) return (T)fn(scale * src);
+        return 0;
+    }
+
+    void ApplyScalar(const std::vector<Change>& changes, std::vector<Armor>& out, bool bRound) {
+        for (std::size_t i = 0; i < changes.size(); i++) {
+            const auto& c = changes[i];
+            auto w = c.w;
+            out[i].armorRating =
+                Scalar(c.src->armorRating, c.scale, [=](float f) { return std::max(1, (int)(w * f)); });
+            out[i].weight = Scalar(c.src->weight, c.scale, [=](float f) { return ScaleWeight(w, f, bRound); });
+            out[i].value = Scalar(c.src->value, c.scale, [=](float f) { return std::max(1, (int)(w * f)); });
+        }
+    }
+
+    void ApplyColumns(const std::vector<Change>& changes, std::vector<Armor>& out, bool bRound, StatColumns& cols) {
+        cols.Clear();
+        for (const auto& c : changes) {
+            auto r = cols.AddRow();
+            cols.Set(r, StatColumns::kArmorRating, (float)c.src->armorRating, c.scale, c.w);
+            cols.Set(r, StatColumns::kWeight, c.src->weight, c.scale, c.w);
+            cols.Set(r, StatColumns::kValue, (float)c.src->value, c.scale, c.w);
+        }
+        cols.Compute(bRound);
+        for (std::size_t i = 0; i < changes.size(); i++) {
+            out[i].armorRating = (std::uint32_t)*cols.Get(i, StatColumns::kArmorRating);
+            out[i].weight = *cols.Get(i, StatColumns::kWeight);
+            out[i].value = (std::int32_t)*cols.Get(i, StatColumns::kValue);
+        }
+    }
+
+    template <class Fn>
+    double Time(Fn&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kRuns; i++) fn();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / kRuns;
+    }
+}
+
+int main() {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    // A few hundred base armors shared by every change, as a handful of sets would be
+    std::vector<Armor> bases(300);
+    for (auto& i : bases) i = {(std::uint32_t)(rng() % 5000), 50.0f * unit(rng), (std::int32_t)(rng() % 3000)};
+
+    std::vector<Change> changes(kItems);
+    for (auto& c : changes) c = {&bases[rng() % bases.size()], 2.0f * unit(rng), unit(rng)};
+
+    std::vector<Armor> outScalar(kItems), outColumns(kItems);
+    StatColumns cols;
+    auto scalar = Time([&] { ApplyScalar(changes, outScalar, true); });
+    auto columns = Time([&] { ApplyColumns(changes, outColumns, true, cols); });
+
+    std::size_t diff = 0;
+    for (std::size_t i = 0; i < kItems; i++)
+        diff += outScalar[i].armorRating != outColumns[i].armorRating || outScalar[i].weight != outColumns[i].weight ||
+                outScalar[i].value != outColumns[i].value;
+
+    std::printf("%zu armor changes: scalar %.3fms, columns %.3fms, %zu differ\n", kItems, scalar, columns, diff);
+}
@@ -0,0 +1,161 @@
+#include "StatMath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+
+using namespace QuickArmorRebalance;
+using namespace QuickArmorRebalance::Test;
+
+namespace {
+    void TestArmorStat() {
+        // Truncated, not rounded, after the relative weight is applied
+        CHECK(ScaleArmorStat(1.0f, 29.9f) == 29);
+        CHECK(ScaleArmorStat(0.5f, 30.0f) == 15);
+        CHECK(ScaleArmorStat(1.5f, 30.0f) == 45);
+
+        // Never drops below 1, however small the weight or scaled stat
+        CHECK(ScaleArmorStat(0.01f, 30.0f) == 1);
+        CHECK(ScaleArmorStat(1.0f, 0.2f) == 1);
+        CHECK(ScaleArmorStat(0.0f, 30.0f) == 1);
+    }
+
+    void TestWeight() {
+        // Left alone without rounding
+        CHECK(ScaleWeight(1.0f, 2.345f, false) == 2.345f);
+        CHECK(ScaleWeight(0.5f, 3.0f, false) == 1.5f);
+        CHECK(ScaleWeight(0.01f, 1.0f, false) == 0.01f);
+
+        // Rounded to a tenth, and never below one tenth
+        CHECK(ScaleWeight(1.0f, 2.345f, true) == 0.1f * 23.0f);
+        CHECK(ScaleWeight(1.0f, 2.36f, true) == 0.1f * 24.0f);
+        CHECK(ScaleWeight(0.5f, 3.0f, true) == 0.1f * 15.0f);
+        CHECK(ScaleWeight(0.01f, 1.0f, true) == 0.1f);
+        CHECK(ScaleWeight(1.0f, 0.0f, true) == 0.1f);
+    }
+
+    void TestWeapDamage() {
+        CHECK(ScaleWeapDamage(12.9f) == 12);
+        CHECK(ScaleWeapDamage(0.5f) == 1);
+        CHECK(ScaleWeapDamage(-4.0f) == 1);
+        CHECK(ScaleWeapDamage(65535.0f) == 65535);
+    }
+
+    void TestAmmoDamage() {
+        // Ammo damage is a float and keeps its fraction
+        CHECK(ScaleAmmoDamage(12.5f) == 12.5f);
+        CHECK(ScaleAmmoDamage(0.5f) == 1.0f);
+        CHECK(ScaleAmmoDamage(0.0f) == 1.0f);
+    }
+
+    // The per item math as ChangeField did it before the batch: the stat is scaled as stored, and only when the
+    // source has it and the scale is positive, otherwise it's zeroed
+    template <class T>
+    T Scalar(T src, float scale, const auto& fn) {
+        if (src && scale > 0.0f) return (T)fn(scale * src);
+        return 0;
+    }
+
+    // One random change of each kind, written to fields the way the batch's scatter does and the way the scalar path
+    // did, which have to agree bit for bit
+    struct Row {
+        float w;
+        float scale;
+        std::uint32_t armorRating;
+        std::int32_t value;
+        float weight;
+        std::uint16_t damage;
+        float speed;
+        float ammoDamage;
+    };
+
+    void TestColumnsMatchScalar(bool bRound) {
+        std::mt19937 rng(bRound ? 7 : 11);
+        auto pick = [&](int n) { return (int)(rng() % n); };
+        auto uniform = [&](float lo, float hi) { return std::uniform_real_distribution<float>(lo, hi)(rng); };
+
+        // Zero sources and non-positive scales are mixed in, they take the other branch
+        std::vector<Row> rows(20000);
+        for (auto& r : rows) {
+            r.w = pick(8) ? uniform(0.0f, 2.0f) : 1.0f;
+            r.scale = pick(10) ? uniform(0.0f, 3.0f) : (float)(pick(3) - 1);
+            r.armorRating = pick(10) ? rng() % 20000 : 0;
+            r.value = pick(10) ? (std::int32_t)(rng() % 100000) : 0;
+            r.weight = pick(10) ? uniform(0.0f, 60.0f) : 0.0f;
+            r.damage = pick(10) ? (std::uint16_t)(rng() % 200) : 0;
+            r.speed = pick(10) ? uniform(0.5f, 1.5f) : 0.0f;
+            r.ammoDamage = pick(10) ? uniform(0.0f, 40.0f) : 0.0f;
+        }
+
+        StatColumns cols;
+        for (const auto& r : rows) {
+            auto i = cols.AddRow();
+            cols.Set(i, StatColumns::kArmorRating, (float)r.armorRating, r.scale, r.w);
+            cols.Set(i, StatColumns::kValue, (float)r.value, r.scale, r.w);
+            cols.Set(i, StatColumns::kWeight, r.weight, r.scale, r.w);
+            cols.Set(i, StatColumns::kWeapDamage, (float)r.damage, r.scale, 1.0f);
+            cols.Set(i, StatColumns::kSpeed, r.speed, r.scale, 1.0f);
+            cols.Set(i, StatColumns::kAmmoDamage, r.ammoDamage, r.scale, 1.0f);
+        }
+        cols.Compute(bRound);
+
+        int mismatches = 0;
+        for (std::size_t i = 0; i < rows.size(); i++) {
+            const auto& r = rows[i];
+            auto w = r.w;
+
+            auto armorRating = Scalar(r.armorRating, r.scale, [=](float f) { return std::max(1, (int)(w * f)); });
+            auto value = Scalar(r.value, r.scale, [=](float f) { return std::max(1, (int)(w * f)); });
+            auto weight = Scalar(r.weight, r.scale, [=](float f) {
+                f *= w;
+                if (bRound) f = std::max(0.1f, 0.1f * std::round(10.0f * f));
+                return f;
+            });
+            auto damage = Scalar(r.damage, r.scale, [](float f) { return (std::uint16_t)std::max(1, (int)f); });
+            auto speed = Scalar(r.speed, r.scale, [](float f) { return f; });
+            auto ammoDamage = Scalar(r.ammoDamage, r.scale, [](float f) { return std::max(1.0f, f); });
+
+            bool bMatch = (std::uint32_t)*cols.Get(i, StatColumns::kArmorRating) == armorRating &&
+                          (std::int32_t)*cols.Get(i, StatColumns::kValue) == value &&
+                          *cols.Get(i, StatColumns::kWeight) == weight &&
+                          (std::uint16_t)*cols.Get(i, StatColumns::kWeapDamage) == damage &&
+                          *cols.Get(i, StatColumns::kSpeed) == speed &&
+                          *cols.Get(i, StatColumns::kAmmoDamage) == ammoDamage;
+            if (!bMatch) mismatches++;
+        }
+        CHECK(mismatches == 0);
+    }
+
+    void TestColumnsChanged() {
+        StatColumns cols;
+        auto a = cols.AddRow();
+        auto b = cols.AddRow();
+        cols.Set(a, StatColumns::kWeight, 10.0f, 0.5f, 1.0f);
+        cols.Set(b, StatColumns::kArmorRating, 20.0f, 1.0f, 1.0f);
+        cols.Unset(b);
+        cols.Compute(false);
+
+        // Only the fields a row set have a result
+        CHECK(cols.Get(a, StatColumns::kWeight) == 5.0f);
+        CHECK(!cols.Get(a, StatColumns::kArmorRating));
+        CHECK(!cols.Get(b, StatColumns::kArmorRating));
+
+        cols.Clear();
+        CHECK(cols.size() == 0);
+    }
+}
+
+int main() {
+    TestArmorStat();
+    TestWeight();
+    TestWeapDamage();
+    TestAmmoDamage();
+    TestColumnsMatchScalar(false);
+    TestColumnsMatchScalar(true);
+    TestColumnsChanged();
+    return TestResult();
+}
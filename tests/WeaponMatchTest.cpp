@@ -0,0 +1,144 @@
+#include "WeaponMatch.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+
+using namespace QuickArmorRebalance;
+using namespace QuickArmorRebalance::Test;
+
+namespace {
+    struct Keyword {
+        std::uint32_t formID;
+    };
+
+    // The members FindMatching reads off a TESObjectWEAP
+    struct Weapon {
+        int type = 0;
+        std::vector<Keyword*> kws;
+        Keyword** keywords = nullptr;
+        unsigned int numKeywords = 0;
+
+        int GetWeaponType() const { return type; }
+        bool HasKeyword(const Keyword* kw) const { return std::find(kws.begin(), kws.end(), kw) != kws.end(); }
+    };
+
+    struct Ammo {
+        bool bBolt;
+    };
+
+    using Index = BasicMatchIndex<Weapon, Ammo>;
+
+    struct Catalog {
+        std::vector<Keyword> keywords;  // The first few are type keywords
+        std::vector<std::unique_ptr<Weapon>> weapons;
+        int nTypeKeywords;
+
+        bool IsTypeKeyword(const Keyword* kw) const { return kw && kw < &keywords[nTypeKeywords]; }
+
+        // Weapons as they come in mods: usually one type keyword among others, sometimes none or two, and now and
+        // then an empty keyword slot
+        Weapon* Make(std::mt19937& rng) {
+            auto& w = *weapons.emplace_back(std::make_unique<Weapon>());
+            w.type = (int)(rng() % 6);
+
+            auto n = rng() % 5;
+            for (unsigned int i = 0; i < n; i++) {
+                auto pick = rng() % 10;
+                if (pick < 4)
+                    w.kws.push_back(&keywords[rng() % nTypeKeywords]);
+                else if (pick < 9)
+                    w.kws.push_back(&keywords[nTypeKeywords + rng() % (keywords.size() - nTypeKeywords)]);
+                else
+                    w.kws.push_back(nullptr);
+            }
+            w.keywords = w.kws.data();
+            w.numKeywords = (unsigned int)w.kws.size();
+            return &w;
+        }
+    };
+
+    void TestWeaponsMatchScan() {
+        std::mt19937 rng(3);
+
+        Catalog catalog;
+        catalog.keywords.resize(20);
+        catalog.nTypeKeywords = 5;
+        for (std::uint32_t i = 0; i < catalog.keywords.size(); i++) catalog.keywords[i].formID = 0x0001e700 + i;
+        auto isTypeKeyword = [&](const Keyword* kw) { return catalog.IsTypeKeyword(kw); };
+
+        std::vector<Weapon*> queries;
+        for (int i = 0; i < 2000; i++) queries.push_back(catalog.Make(rng));
+
+        int nMatched = 0, nMismatched = 0;
+        for (int s = 0; s < 200; s++) {
+            // Sets from empty up to a few dozen weapons, types and keywords overlapping
+            std::set<Weapon*> weaps;
+            auto n = rng() % 40;
+            for (unsigned int i = 0; i < n; i++) weaps.insert(catalog.Make(rng));
+
+            Index index;
+            index.Build(weaps, {}, isTypeKeyword, [](const Ammo* a) { return a->bBolt; });
+            CHECK(index.bBuilt);
+
+            for (auto w : queries) {
+                auto scan = FindMatchingWeapon(weaps, w, isTypeKeyword);
+                if (index.Find(w) != scan) nMismatched++;
+                if (scan) nMatched++;
+            }
+
+            // And the set's own weapons, which match themselves or an earlier one when they have a type keyword
+            for (auto w : weaps) {
+                if (index.Find(w) != FindMatchingWeapon(weaps, w, isTypeKeyword)) nMismatched++;
+            }
+        }
+
+        CHECK(nMismatched == 0);
+        CHECK(nMatched > 1000);  // Or the comparison isn't saying much
+    }
+
+    void TestAmmoMatchScan() {
+        auto isBolt = [](const Ammo* a) { return a->bBolt; };
+        std::vector<Ammo> ammo{{false}, {true}, {false}, {true}};
+        Ammo arrow{false}, bolt{true};
+
+        std::vector<std::set<Ammo*>> sets{
+            {}, {&ammo[0]}, {&ammo[1], &ammo[3]}, {&ammo[0], &ammo[1], &ammo[2], &ammo[3]}};
+        for (const auto& set : sets) {
+            Index index;
+            index.Build({}, set, [](const Keyword*) { return false; }, isBolt);
+            for (auto a : {&arrow, &bolt}) CHECK(index.Find(a, isBolt) == FindMatchingAmmo(set, a, isBolt));
+        }
+    }
+
+    void TestRebuild() {
+        Keyword typeKw{1};
+        Weapon sword;
+        sword.kws = {&typeKw};
+        sword.keywords = sword.kws.data();
+        sword.numKeywords = 1;
+        auto isTypeKeyword = [&](const Keyword* kw) { return kw == &typeKw; };
+        auto isBolt = [](const Ammo* a) { return a->bBolt; };
+
+        Index index;
+        Ammo arrow{false};
+        index.Build({&sword}, {&arrow}, isTypeKeyword, isBolt);
+        CHECK(index.Find(&sword) == &sword);
+        CHECK(index.Find(&arrow, isBolt) == &arrow);
+
+        // Building again starts from nothing
+        index.Build({}, {}, isTypeKeyword, isBolt);
+        CHECK(!index.Find(&sword));
+        CHECK(!index.Find(&arrow, isBolt));
+    }
+}
+
+int main() {
+    TestWeaponsMatchScan();
+    TestAmmoMatchScan();
+    TestRebuild();
+    return TestResult();
+}